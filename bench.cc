@@ -0,0 +1,395 @@
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cfg_generator.h"
+#include "dominators.h"
+#include "flow_graph.h"
+#include "ssa_pre.h"
+
+// Scaling benchmark for the LCM pipeline. For every size from --min-size to
+// --max-size (factors of 10) a random CFG is generated and each stage is
+// timed. One JSON object per stage and size is written to stdout:
+//
+//   {"size":1000,"stage":"DownSafety","seconds":1.2e-05,"visits":1003,
+//    "peak_rss_kb":3528}
+//
+// visits is the number of worklist pops (0 for stages without a worklist)
+// and peak_rss_kb the process memory high-water mark after the stage.
+// --engine worklist|scc|elim|all picks the FlowGraph solver engine; the
+// four analysis stages then also carry "engine", and the "SCC" stage times
+// the component computation (visits = number of components). For elim,
+// visits counts folding steps plus value recoveries.
+// --worklist ordered|fifo|both picks the worklist policy (Worklist::Order)
+// of the solvers; with anything but ordered the stages carry "worklist",
+// and both solves the same CFG once per policy.
+// "Safety" solves DownSafety and UpSafety again, on two threads; the
+// Earliestness stage after it is a single pass over the nodes.
+// With --exprs N the bit-vector BitFlowGraph solves N expressions at once
+// instead, with the same engines, sliced over --threads T threads; its
+// BitEarliestness is likewise one pass after BitUpSafety. With
+// --edits K, K random use flags are toggled after the full solve and the
+// "Incremental" stage times FlowGraph::Incremental::update().
+// --engine sparse t-refines every graph ("TRefine"), solves it with the
+// worklist engine, then times the dominator tree ("Dominators", built once
+// per CFG) and SSAPRE ("SSAPRE", visits = sparse occurrences, Φs and
+// operands) and writes one more line comparing the two placements:
+//
+//   {"size":1000,"stage":"SSAPRECheck","phis":42,"mismatches":0}
+
+namespace {
+
+void report(int size, const char *stage, double seconds, long visits,
+            const char *engine, const char *worklist) {
+  std::printf("{\"size\":%d,\"stage\":\"%s\",", size, stage);
+  if (engine) {
+    std::printf("\"engine\":\"%s\",", engine);
+  }
+  if (worklist) {
+    std::printf("\"worklist\":\"%s\",", worklist);
+  }
+  std::printf("\"seconds\":%.6g,\"visits\":%ld,\"peak_rss_kb\":%ld}\n",
+              seconds, visits, peakRSSKb());
+  std::fflush(stdout);
+}
+
+// Time fn() and report it as one stage.
+template <typename Fn>
+void stage(int size, const char *name, Fn fn, const char *engine = nullptr,
+           const char *worklist = nullptr) {
+  auto start = std::chrono::steady_clock::now();
+  long visits = fn();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  report(size, name, elapsed.count(), visits, engine, worklist);
+}
+
+const char *engineName(FlowGraph::Engine engine) {
+  switch (engine) {
+  case FlowGraph::Engine::SCC:
+    return "scc";
+  case FlowGraph::Engine::Elimination:
+    return "elim";
+  default:
+    return "worklist";
+  }
+}
+
+// Label of a worklist policy; none for a run with only the default one.
+const char *orderName(const std::vector<Worklist::Order> &orders,
+                      Worklist::Order order) {
+  if (order == Worklist::Order::FIFO) {
+    return "fifo";
+  }
+  return orders.size() > 1 ? "ordered" : nullptr;
+}
+
+// The sparse engine on a solved graph, cross-checked against the dense
+// placement.
+void runSparse(int size, const FlowGraph &g) {
+  std::unique_ptr<DominatorTree> dom;
+  stage(
+      size, "Dominators",
+      [&] {
+        dom = std::make_unique<DominatorTree>(g);
+        return 0L;
+      },
+      "sparse");
+  SSAPRE pre{g, *dom};
+  stage(
+      size, "SSAPRE",
+      [&] {
+        pre.compute();
+        return pre.getVisitCount();
+      },
+      "sparse");
+  std::printf("{\"size\":%d,\"stage\":\"SSAPRECheck\",\"phis\":%d,"
+              "\"mismatches\":%d}\n",
+              size, pre.getPhiCount(), pre.crossCheck());
+  std::fflush(stdout);
+}
+
+void runSize(CFGGenerator::Options opts, int edits,
+             const std::vector<FlowGraph::Engine> &engines,
+             const std::vector<Worklist::Order> &orders, bool sparse) {
+  int size = opts.numNodes;
+  std::unique_ptr<FlowGraph> g;
+  stage(size, "generate", [&] {
+    g = CFGGenerator(opts).generate();
+    return 0L;
+  });
+  stage(size, "finalize", [&] {
+    g->finalize();
+    return 0L;
+  });
+  if (sparse) {
+    stage(size, "TRefine",
+          [&] { return static_cast<long>(g->makeTRefined()); });
+  }
+
+  for (FlowGraph::Engine engine : engines) {
+    const char *name =
+        engines.size() > 1 || engine != FlowGraph::Engine::Worklist || sparse
+            ? engineName(engine)
+            : nullptr;
+    g->setEngine(engine);
+    if (engine == FlowGraph::Engine::SCC) {
+      stage(size, "SCC", [&] {
+        g->computeSCCs();
+        return static_cast<long>(g->getSCCCount());
+      });
+    }
+    for (Worklist::Order order : orders) {
+      const char *list = orderName(orders, order);
+      g->setWorklistOrder(order);
+      FlowGraph::DownSafety<NoTrace> d_safe{*g};
+      stage(
+          size, "DownSafety",
+          [&] {
+            d_safe.compute();
+            return d_safe.getVisitCount();
+          },
+          name, list);
+      FlowGraph::UpSafety<NoTrace> u_safe{*g};
+      stage(
+          size, "UpSafety",
+          [&] {
+            u_safe.compute();
+            return u_safe.getVisitCount();
+          },
+          name, list);
+      FlowGraph::Safety<NoTrace> safety{*g};
+      stage(
+          size, "Safety",
+          [&] {
+            safety.compute();
+            return safety.getVisitCount();
+          },
+          name, list);
+      FlowGraph::Earliestness<NoTrace> early{*g};
+      stage(
+          size, "Earliestness",
+          [&] {
+            early.compute();
+            return early.getVisitCount();
+          },
+          name, list);
+      FlowGraph::DelayLatest<NoTrace> delay{*g};
+      stage(
+          size, "DelayLatest",
+          [&] {
+            delay.compute();
+            return delay.getVisitCount();
+          },
+          name, list);
+      FlowGraph::Isolated<NoTrace> isolated{*g};
+      stage(
+          size, "Isolated",
+          [&] {
+            isolated.compute();
+            return isolated.getVisitCount();
+          },
+          name, list);
+    }
+  }
+  if (sparse) {
+    runSparse(size, *g);
+  }
+
+  if (edits > 0) {
+    FlowGraph::Incremental<NoTrace> inc{*g};
+    inc.compute();
+    std::mt19937_64 rng(opts.seed);
+    std::uniform_int_distribution<int> node(1, size);
+    for (int k = 0; k < edits; ++k) {
+      int u = node(rng);
+      g->setUsed(u, !g->isUsed(u));
+    }
+    stage(size, "Incremental", [&] {
+      inc.update();
+      return inc.getVisitCount();
+    });
+  }
+}
+
+// Bit-vector mode: numExprs expressions solved together, with the
+// expression words sliced over `threads` threads.
+void runBitSize(CFGGenerator::Options opts, int numExprs, int threads,
+                const std::vector<FlowGraph::Engine> &engines,
+                const std::vector<Worklist::Order> &orders) {
+  int size = opts.numNodes;
+  std::unique_ptr<BitFlowGraph> g;
+  stage(size, "BitGenerate", [&] {
+    g = CFGGenerator(opts).generateBits(numExprs);
+    g->setParallelism(threads);
+    return 0L;
+  });
+  stage(size, "BitFinalize", [&] {
+    g->finalize();
+    return 0L;
+  });
+
+  for (FlowGraph::Engine engine : engines) {
+    const char *name =
+        engines.size() > 1 || engine != FlowGraph::Engine::Worklist
+            ? engineName(engine)
+            : nullptr;
+    g->setEngine(engine);
+    for (Worklist::Order order : orders) {
+      const char *list = orderName(orders, order);
+      g->setWorklistOrder(order);
+      BitFlowGraph::DownSafety d_safe{*g};
+      stage(
+          size, "BitDownSafety",
+          [&] {
+            d_safe.compute();
+            return d_safe.getVisitCount();
+          },
+          name, list);
+      BitFlowGraph::UpSafety u_safe{*g};
+      stage(
+          size, "BitUpSafety",
+          [&] {
+            u_safe.compute();
+            return u_safe.getVisitCount();
+          },
+          name, list);
+      BitFlowGraph::Earliestness early{*g};
+      stage(
+          size, "BitEarliestness",
+          [&] {
+            early.compute();
+            return early.getVisitCount();
+          },
+          name, list);
+      BitFlowGraph::DelayLatest delay{*g};
+      stage(
+          size, "BitDelayLatest",
+          [&] {
+            delay.compute();
+            return delay.getVisitCount();
+          },
+          name, list);
+      BitFlowGraph::Isolated isolated{*g};
+      stage(
+          size, "BitIsolated",
+          [&] {
+            isolated.compute();
+            return isolated.getVisitCount();
+          },
+          name, list);
+    }
+  }
+}
+
+void usage(const char *prog) {
+  std::cerr << "usage: " << prog
+            << " [--min-size N] [--max-size N] [--seed S] [--branch P]"
+               " [--switch P] [--loop P] [--loop-depth D] [--gotos R]"
+               " [--used P] [--killed P] [--exprs N] [--threads T]"
+               " [--edits K] [--engine worklist|scc|elim|all|sparse]"
+               " [--worklist ordered|fifo|both]\n"
+               "  N and T must be positive, D, R, K and --exprs must not be"
+               " negative and P must lie in [0, 1]\n";
+}
+
+// Parses the whole of value into out; false on junk, overflow or nothing.
+template <typename T> bool parse(std::string_view value, T &out) {
+  auto [ptr, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), out);
+  return ec == std::errc() && ptr == value.data() + value.size();
+}
+
+bool parseProb(std::string_view value, double &out) {
+  return parse(value, out) && out >= 0.0 && out <= 1.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  CFGGenerator::Options opts;
+  int minSize = 100;
+  int maxSize = 1000000;
+  int numExprs = 0;
+  int threads = 1;
+  int edits = 0;
+  bool sparse = false;
+  std::vector<FlowGraph::Engine> engines = {FlowGraph::Engine::Worklist};
+  std::vector<Worklist::Order> orders = {Worklist::Order::Ordered};
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    std::string flag = argv[i];
+    const char *value = argv[++i];
+    bool ok = true;
+    if (flag == "--min-size") {
+      ok = parse(value, minSize) && minSize > 0;
+    } else if (flag == "--max-size") {
+      ok = parse(value, maxSize) && maxSize > 0;
+    } else if (flag == "--seed") {
+      ok = parse(value, opts.seed);
+    } else if (flag == "--branch") {
+      ok = parseProb(value, opts.branchProb);
+    } else if (flag == "--switch") {
+      ok = parseProb(value, opts.switchProb);
+    } else if (flag == "--loop") {
+      ok = parseProb(value, opts.loopProb);
+    } else if (flag == "--loop-depth") {
+      ok = parse(value, opts.maxLoopDepth) && opts.maxLoopDepth >= 0;
+    } else if (flag == "--gotos") {
+      ok = parse(value, opts.gotoRatio) && opts.gotoRatio >= 0.0;
+    } else if (flag == "--used") {
+      ok = parseProb(value, opts.usedDensity);
+    } else if (flag == "--killed") {
+      ok = parseProb(value, opts.killedDensity);
+    } else if (flag == "--exprs") {
+      ok = parse(value, numExprs) && numExprs >= 0;
+    } else if (flag == "--threads") {
+      ok = parse(value, threads) && threads > 0;
+    } else if (flag == "--edits") {
+      ok = parse(value, edits) && edits >= 0;
+    } else if (flag == "--engine" && std::strcmp(value, "worklist") == 0) {
+      engines = {FlowGraph::Engine::Worklist};
+    } else if (flag == "--engine" && std::strcmp(value, "scc") == 0) {
+      engines = {FlowGraph::Engine::SCC};
+    } else if (flag == "--engine" && std::strcmp(value, "elim") == 0) {
+      engines = {FlowGraph::Engine::Elimination};
+    } else if (flag == "--engine" && std::strcmp(value, "all") == 0) {
+      engines = {FlowGraph::Engine::Worklist, FlowGraph::Engine::SCC,
+                 FlowGraph::Engine::Elimination};
+    } else if (flag == "--engine" && std::strcmp(value, "sparse") == 0) {
+      engines = {FlowGraph::Engine::Worklist};
+      sparse = true;
+    } else if (flag == "--worklist" && std::strcmp(value, "ordered") == 0) {
+      orders = {Worklist::Order::Ordered};
+    } else if (flag == "--worklist" && std::strcmp(value, "fifo") == 0) {
+      orders = {Worklist::Order::FIFO};
+    } else if (flag == "--worklist" && std::strcmp(value, "both") == 0) {
+      orders = {Worklist::Order::Ordered, Worklist::Order::FIFO};
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  for (long size = minSize; size <= maxSize; size *= 10) {
+    opts.numNodes = static_cast<int>(size);
+    if (numExprs > 0) {
+      runBitSize(opts, numExprs, threads, engines, orders);
+    } else {
+      runSize(opts, edits, engines, orders, sparse);
+    }
+  }
+  return 0;
+}
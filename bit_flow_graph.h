@@ -0,0 +1,686 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "csr_graph.h"
+#include "elimination.h"
+#include "parallel.h"
+#include "pass_stats.h"
+#include "trace.h"
+
+// Multi-expression variant of FlowGraph: every node carries one bit per
+// candidate expression, packed into 64-bit words, so a single fixpoint solve
+// places all expressions at once. The equations are exactly those of the
+// FlowGraph analyses, lifted to bitwise AND/OR over whole words. The word
+// loops are kept branch-free so the compiler can vectorize them (AVX2/AVX-512
+// with -march=native). Very wide problems can be sliced across threads, see
+// setParallelism().
+class BitFlowGraph : public CSRGraph {
+public:
+  using Word = std::uint64_t;
+
+  // A run of expression words [begin, begin + count) solved on its own.
+  struct Slice {
+    int begin;
+    int count;
+  };
+
+  BitFlowGraph(int size, int numExprs)
+      : CSRGraph(size + 2), _numExprs(numExprs),
+        _words((numExprs + 63) / 64),
+        _stride(_words <= kCacheLineWords
+                    ? _words
+                    : (_words + kCacheLineWords - 1) / kCacheLineWords *
+                          kCacheLineWords) {
+    std::size_t cells = static_cast<std::size_t>(_size) * _stride;
+    _used.assign(cells, 0);
+    _killed.assign(cells, 0);
+    _downsafety.assign(cells, 0);
+    _upsafety.assign(cells, 0);
+    _earliestness.assign(cells, 0);
+    _delay.assign(cells, 0);
+    _latest.assign(cells, 0);
+    _isolated.assign(cells, 0);
+  }
+
+  // Edits make UpSafety stale, see Earliestness::compute().
+  void addEdge(int u, int v) {
+    CSRGraph::addEdge(u, v);
+    _upSafetyStale = true;
+  }
+
+  void removeEdge(int u, int v) {
+    CSRGraph::removeEdge(u, v);
+    _upSafetyStale = true;
+  }
+
+  void setUsed(int u, int expr) {
+    setBit(_used, u, expr);
+    _upSafetyStale = true;
+  }
+
+  void setKilled(int u, int expr) {
+    setBit(_killed, u, expr);
+    _upSafetyStale = true;
+  }
+
+  int splitCriticalEdges() {
+    _upSafetyStale = true;
+    int oldExit = _size - 1;
+    int count = splitCriticalEdgesCSR();
+    growAllNodes(oldExit, count);
+    return count;
+  }
+
+  // A node counts as killing if it kills any of the expressions.
+  int makeTRefined() {
+    _upSafetyStale = true;
+    int oldExit = _size - 1;
+    int count = makeTRefinedCSR([this](int u) {
+      const Word *killed = row(_killed, u);
+      return std::any_of(killed, killed + _words,
+                         [](Word w) { return w != 0; });
+    });
+    growAllNodes(oldExit, count);
+    return count;
+  }
+
+  int getNumExprs() const { return _numExprs; }
+
+  // The expressions are independent in every analysis, so the expression
+  // words are cut into slices of sliceWords words (default: one cache line,
+  // 512 expressions) that are solved separately on up to `threads` threads
+  // over the shared, read-only CSR graph. Each slice writes only its own
+  // words of the result rows, so the placement report needs no merge step.
+  void setParallelism(int threads, int sliceWords = kCacheLineWords) {
+    _threads = std::max(1, threads);
+    _sliceWords = std::max(1, sliceWords);
+  }
+
+  bool isUsed(int u, int expr) const { return testBit(_used, u, expr); }
+
+  bool isKilled(int u, int expr) const { return testBit(_killed, u, expr); }
+
+  bool isDownSafe(int u, int expr) const {
+    return testBit(_downsafety, u, expr);
+  }
+
+  bool isUpSafe(int u, int expr) const { return testBit(_upsafety, u, expr); }
+
+  bool isEarliest(int u, int expr) const {
+    return testBit(_earliestness, u, expr);
+  }
+
+  bool isDelay(int u, int expr) const { return testBit(_delay, u, expr); }
+
+  bool isLatest(int u, int expr) const { return testBit(_latest, u, expr); }
+
+  bool isIsolated(int u, int expr) const {
+    return testBit(_isolated, u, expr);
+  }
+
+  void getPlacementBCM(std::ostream &outs = std::cout) const {
+    outs << "[Get Placement of BCM]:\n";
+    for (int e = 0; e < _numExprs; ++e) {
+      outs << "[Expression " << e << "]: ";
+      for (int i = 1; i < _size - 1; ++i) {
+        if (isDownSafe(i, e) && isEarliest(i, e)) {
+          printNode(i, outs);
+        }
+      }
+      outs << "\n";
+    }
+  }
+
+  void getPlacementLCM(std::ostream &outs = std::cout) const {
+    outs << "[Get Placement of LCM]:\n";
+    for (int e = 0; e < _numExprs; ++e) {
+      outs << "[Expression " << e << "]:\n";
+      outs << "[Optimal Computation Points]: ";
+      for (int i = 1; i < _size - 1; ++i) {
+        if (isLatest(i, e) && !isIsolated(i, e)) {
+          printNode(i, outs);
+        }
+      }
+      outs << "\n";
+
+      outs << "[Isolated Computation]: ";
+      for (int i = 1; i < _size - 1; ++i) {
+        if (isLatest(i, e) && isIsolated(i, e)) {
+          printNode(i, outs);
+        }
+      }
+      outs << "\n";
+
+      outs << "[Redundant Occurrence]: ";
+      for (int i = 1; i < _size - 1; ++i) {
+        if (testBit(_used, i, e) && !(isLatest(i, e) && isIsolated(i, e))) {
+          printNode(i, outs);
+        }
+      }
+      outs << "\n";
+    }
+  }
+
+private:
+  using WordVector = std::vector<Word, CacheAlignedAllocator<Word>>;
+  using Fn = EliminationSolver::Fn;
+
+  // The function of a CFG edge on one expression word: bit e of the result
+  // is bit e of one, or else bit e of x where id has it set. Zero, One and
+  // Id of the one-bit solvers are {0, 0}, {~0, 0} and {0, ~0}.
+  struct WordFn {
+    Word one;
+    Word id;
+  };
+
+  // The problems of the pipeline, word w of the FlowGraph problems of the
+  // same name.
+
+  // x_u = used(u) | (!killed(u) & AND of the successors); 0 at the exit.
+  struct DownSafetyProblem {
+    static constexpr bool kForward = false;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "D-Safe";
+    static constexpr const char *kPass = "DownSafety";
+
+    static std::pair<Word, Word> node(const BitFlowGraph &g, int u, int w) {
+      if (u == g._size - 1) {
+        return {0, ~Word(0)};
+      }
+      return {g.row(g._used, u)[w], g.row(g._killed, u)[w]};
+    }
+
+    static WordFn edge(const BitFlowGraph &, int, int, int) {
+      return {0, ~Word(0)};
+    }
+  };
+
+  // Up-safety (availability): x_v = AND over the predecessors u of
+  // (comp(u) | (x_u & !killed(u))), where comp = used & !killed. The entry
+  // block is no placement point, so nothing is up-safe below it.
+  struct UpSafetyProblem {
+    static constexpr bool kForward = true;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "U-Safe";
+    static constexpr const char *kPass = "UpSafety";
+
+    static std::pair<Word, Word> node(const BitFlowGraph &, int v, int) {
+      return {0, v == 0 ? ~Word(0) : 0};
+    }
+
+    static WordFn edge(const BitFlowGraph &g, int u, int, int w) {
+      Word killed = g.row(g._killed, u)[w];
+      return {g.row(g._used, u)[w] & ~killed, u == 0 ? 0 : ~killed};
+    }
+  };
+
+  // x_v = (dsafe(v) & earliest(v)) | AND over the predecessors u of
+  // (!used(u) & x_u); 0 at the entry.
+  struct DelayProblem {
+    static constexpr bool kForward = true;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "Delay";
+    static constexpr const char *kPass = "Delay";
+
+    static std::pair<Word, Word> node(const BitFlowGraph &g, int v, int w) {
+      if (v == 0) {
+        return {0, ~Word(0)};
+      }
+      return {g.row(g._downsafety, v)[w] & g.row(g._earliestness, v)[w], 0};
+    }
+
+    static WordFn edge(const BitFlowGraph &g, int u, int, int w) {
+      return {0, ~g.row(g._used, u)[w]};
+    }
+  };
+
+  // x_u = AND over the successors v of (latest(v) | (!used(v) &
+  // (killed(v) | x_v))): a kill ends h, as in FlowGraph. 1 at the exit.
+  struct IsolatedProblem {
+    static constexpr bool kForward = false;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "Isolated";
+    static constexpr const char *kPass = "Isolated";
+
+    static std::pair<Word, Word> node(const BitFlowGraph &g, int u, int) {
+      return {u == g._size - 1 ? ~Word(0) : 0, 0};
+    }
+
+    static WordFn edge(const BitFlowGraph &g, int, int v, int w) {
+      Word used = g.row(g._used, v)[w];
+      return {g.row(g._latest, v)[w] | (~used & g.row(g._killed, v)[w]),
+              ~used};
+    }
+  };
+
+public:
+  // One fixpoint solver for the passes below, FlowGraph::Dataflow lifted
+  // to words. node(g, n, w) returns {C, F} and edge(g, u, v, w) the WordFn
+  // of CFG edge u -> v for expression word w, and every bit follows the
+  // one-bit equation
+  //
+  //   x_n = C | (F ? A : MEET over the dependencies m of edge(m)(x_m))
+  //
+  // so 64 expressions cost one AND/OR step. Each slice of the words (see
+  // setParallelism()) is solved on its own with the graph's engine; the
+  // Elimination engine goes through EliminationSolver one expression at a
+  // time. Tracing names every expression ("D-Safe#3") and keeps the slices
+  // on one thread.
+  template <typename Problem, typename Trace> class Dataflow {
+  public:
+    Dataflow(BitFlowGraph &g, WordVector &result, Trace trace)
+        : _g(g), _result(result), _trace(trace) {}
+
+    // Number of nodes popped from the worklists (summed over all slices) by
+    // the last compute(), or elimination steps with the Elimination engine.
+    // The other counters are in the graph's pass stats under Problem::kPass;
+    // changes there counts changed node rows of a slice, not single bits.
+    long getVisitCount() const { return _visits; }
+
+    void compute() {
+      PassRecorder recorder(_g._passStats, Problem::kPass);
+      _g.finalize();
+      if (_g._engine != Engine::Worklist) {
+        _g.computeSCCs();
+      }
+      _g.forEachSlice(recorder.stats(), std::is_same_v<Trace, NoTrace>,
+                      [this](Slice s) { return solveSlice(s); });
+      _visits = recorder.stats().visits;
+      _trace.flush();
+    }
+
+  protected:
+    BitFlowGraph &_g;
+    WordVector &_result;
+    long _visits = 0;
+    Trace _trace;
+
+  private:
+    static constexpr Word kTop = Problem::kMeetAnd ? ~Word(0) : Word(0);
+
+    static constexpr int kBoundary(int size) {
+      return Problem::kForward ? 0 : size - 1;
+    }
+
+    std::span<const int> dependencies(int n) const {
+      return Problem::kForward ? _g.getPrecessors(n) : _g.getSuccessors(n);
+    }
+
+    std::span<const int> dependents(int n) const {
+      return Problem::kForward ? _g.getSuccessors(n) : _g.getPrecessors(n);
+    }
+
+    PassStats solveSlice(Slice s) {
+      PassStats stats;
+      int size = _g._size;
+      std::vector<Word> tmp(s.count);
+      _g.fillSlice(_result, s, kTop);
+      if (eliminate(s, stats)) {
+        stats.changes = _g.countChanged(_result, s, kTop);
+        return stats;
+      }
+      evaluate(kBoundary(size), s, tmp.data());
+      _g.store(_result, kBoundary(size), s, tmp.data());
+
+      Worklist worklist{
+          Problem::kForward ? _g.getRPORank() : _g.getPostOrderRank(),
+          _g.getWorklistOrder()};
+      int first = Problem::kForward ? 1 : 0;
+      _g.runEngine(worklist, Problem::kForward, first, first + size - 2,
+                   [&](Worklist &w, int scc) {
+                     solve(w, s, tmp.data(), stats, scc);
+                   });
+      stats.visits = worklist.getVisits();
+      stats.pushes = worklist.getPushes();
+      stats.iterations = worklist.getSweeps();
+      return stats;
+    }
+
+    void evaluate(int n, Slice s, Word *res) const {
+      std::fill_n(res, s.count, kTop);
+      for (int m : dependencies(n)) {
+        const Word *x = _g.row(_result, m) + s.begin;
+        for (int w = 0; w < s.count; ++w) {
+          WordFn fn = Problem::kForward
+                          ? Problem::edge(_g, m, n, s.begin + w)
+                          : Problem::edge(_g, n, m, s.begin + w);
+          Word term = fn.one | (fn.id & x[w]);
+          res[w] = Problem::kMeetAnd ? res[w] & term : res[w] | term;
+        }
+      }
+      for (int w = 0; w < s.count; ++w) {
+        auto [c, forced] = Problem::node(_g, n, s.begin + w);
+        res[w] = c | (Problem::kMeetAnd ? res[w] & ~forced : res[w] | forced);
+      }
+    }
+
+    void solve(Worklist &worklist, Slice s, Word *tmp, PassStats &stats,
+               int scc) {
+      while (!worklist.empty()) {
+        int n = worklist.pop();
+        evaluate(n, s, tmp);
+        trace(n, s, tmp);
+        if (_g.store(_result, n, s, tmp)) {
+          ++stats.changes;
+          for (int m : dependents(n)) {
+            if (_g.inScope(m, scc)) {
+              worklist.push(m);
+              _trace.push(m);
+            }
+          }
+        }
+      }
+    }
+
+    void trace(int n, Slice s, const Word *res) {
+      _g.traceRow(_trace, Problem::kName, _result, n, s, res);
+    }
+
+    // The Elimination engine: every expression of the slice is a one-bit
+    // system of its own. Returns false, leaving the slice alone, when
+    // another engine is selected or the graph is irreducible (found on the
+    // first expression already), in which case the caller iterates.
+    bool eliminate(Slice s, PassStats &stats) {
+      if (_g._engine != Engine::Elimination) {
+        return false;
+      }
+      EliminationSolver solver(_g, Problem::kForward, Problem::kMeetAnd);
+      for (int w = s.begin; w < s.begin + s.count; ++w) {
+        for (int b = 0; b < 64 && w * 64 + b < _g._numExprs; ++b) {
+          Word bit = Word(1) << b;
+          bool reducible = solver.solve(
+              [&](int n) {
+                auto [c, forced] = Problem::node(_g, n, w);
+                return std::pair<int, int>((c & bit) != 0,
+                                           (forced & bit) != 0);
+              },
+              [&](int u, int v) {
+                WordFn fn = Problem::edge(_g, u, v, w);
+                return fn.one & bit  ? Fn::One
+                       : fn.id & bit ? Fn::Id
+                                     : Fn::Zero;
+              },
+              [&](int n, int value) {
+                Word &cell = _g.row(_result, n)[w];
+                cell = value ? cell | bit : cell & ~bit;
+              });
+          if (!reducible) {
+            return false;
+          }
+          stats.visits += solver.getSteps();
+        }
+      }
+      // One sweep to fold the graph and one to recover the values.
+      stats.iterations = 2;
+      return true;
+    }
+  };
+
+  template <typename Trace = NoTrace>
+  class DownSafety : public Dataflow<DownSafetyProblem, Trace> {
+  public:
+    DownSafety(BitFlowGraph &g, Trace trace = Trace())
+        : Dataflow<DownSafetyProblem, Trace>(g, g._downsafety, trace) {}
+  };
+
+  template <typename Trace = NoTrace>
+  class UpSafety : public Dataflow<UpSafetyProblem, Trace> {
+  public:
+    UpSafety(BitFlowGraph &g, Trace trace = Trace())
+        : Dataflow<UpSafetyProblem, Trace>(g, g._upsafety, trace) {}
+
+    void compute() {
+      this->_g._upSafetyStale = false;
+      Dataflow<UpSafetyProblem, Trace>::compute();
+    }
+  };
+
+  // Earliestness is local once both safety predicates are known, as in
+  // FlowGraph: one pass over the nodes, no fixpoint. compute() runs
+  // UpSafety first if an edit made it stale; DownSafety must be current.
+  template <typename Trace = NoTrace> class Earliestness {
+  public:
+    Earliestness(BitFlowGraph &g, Trace trace = Trace())
+        : _g(g), _trace(trace) {}
+
+    // Number of nodes evaluated (summed over all slices) by the last
+    // compute().
+    long getVisitCount() const { return _visits; }
+
+    void compute() {
+      _g.finalize();
+      if (_g._upSafetyStale) {
+        UpSafety<Trace>{_g, _trace}.compute();
+      }
+
+      PassRecorder recorder(_g._passStats, "Earliestness");
+      _g.forEachSlice(recorder.stats(), std::is_same_v<Trace, NoTrace>,
+                      [this](Slice s) {
+                        return _g.computeEarliest(s, _trace);
+                      });
+      _visits = recorder.stats().visits;
+      _trace.flush();
+    }
+
+  private:
+    BitFlowGraph &_g;
+    Trace _trace;
+    long _visits = 0;
+  };
+
+  // Delay, then Latest from it in one local pass.
+  template <typename Trace = NoTrace>
+  class DelayLatest : public Dataflow<DelayProblem, Trace> {
+  public:
+    DelayLatest(BitFlowGraph &g, Trace trace = Trace())
+        : Dataflow<DelayProblem, Trace>(g, g._delay, trace) {}
+
+    void compute() {
+      Dataflow<DelayProblem, Trace>::compute();
+      BitFlowGraph &g = this->_g;
+      PassRecorder recorder(g._passStats, "Latest");
+      g.forEachSlice(recorder.stats(), true,
+                     [&g](Slice s) { return g.computeLatest(s); });
+    }
+  };
+
+  template <typename Trace = NoTrace>
+  class Isolated : public Dataflow<IsolatedProblem, Trace> {
+  public:
+    Isolated(BitFlowGraph &g, Trace trace = Trace())
+        : Dataflow<IsolatedProblem, Trace>(g, g._isolated, trace) {}
+  };
+
+private:
+  int _numExprs;
+  int _words;
+  // Words per node row. Rows wider than a cache line are padded to whole
+  // lines so that slices of different threads never share one.
+  int _stride;
+  int _threads = 1;
+  int _sliceWords = kCacheLineWords;
+  WordVector _used;
+  WordVector _killed;
+  WordVector _downsafety;
+  WordVector _upsafety;
+  WordVector _earliestness;
+  WordVector _delay;
+  WordVector _latest;
+  WordVector _isolated;
+  // Set by every edit, cleared by UpSafety; see Earliestness::compute().
+  bool _upSafetyStale = true;
+
+  static constexpr int kCacheLineWords = 64 / sizeof(Word);
+
+  Word *row(WordVector &vec, int u) {
+    return vec.data() + static_cast<std::size_t>(u) * _stride;
+  }
+
+  const Word *row(const WordVector &vec, int u) const {
+    return vec.data() + static_cast<std::size_t>(u) * _stride;
+  }
+
+  // Run solve(slice) for every slice of the expression words, in parallel
+  // when setParallelism() asked for it and parallel is set, and add the
+  // counters the slices return up into stats. iterations is the largest
+  // sweep count of any slice.
+  template <typename Solve>
+  void forEachSlice(PassStats &stats, bool parallel, Solve solve) {
+    int slices = (_words + _sliceWords - 1) / _sliceWords;
+    std::vector<PassStats> counts(slices);
+    parallelFor(slices, parallel ? _threads : 1, [&](std::size_t k) {
+      int begin = static_cast<int>(k) * _sliceWords;
+      counts[k] = solve(Slice{begin, std::min(_sliceWords, _words - begin)});
+    });
+    for (const PassStats &c : counts) {
+      stats.visits += c.visits;
+      stats.pushes += c.pushes;
+      stats.changes += c.changes;
+      stats.iterations = std::max(stats.iterations, c.iterations);
+    }
+  }
+
+  // earliest(v) for the words of one slice: 1 if some predecessor u is the
+  // entry, or a block below which a + b is neither available nor
+  // computable, i.e. !comp(u) & (killed(u) | !(dsafe(u) | usafe(u))).
+  template <typename Trace> PassStats computeEarliest(Slice s, Trace &trace) {
+    PassStats stats;
+    std::vector<Word> tmp(s.count);
+    std::fill_n(row(_earliestness, 0) + s.begin, s.count, ~Word(0));
+    for (int v = 1; v < _size; ++v) {
+      std::fill(tmp.begin(), tmp.end(), Word(0));
+      for (auto tmp_u : getPrecessors(v)) {
+        // The entry node is no placement point, so nothing is available
+        // on its out-edges even where it is down-safe.
+        if (tmp_u == 0) {
+          std::fill(tmp.begin(), tmp.end(), ~Word(0));
+          break;
+        }
+        const Word *used_u = row(_used, tmp_u) + s.begin;
+        const Word *killed_u = row(_killed, tmp_u) + s.begin;
+        const Word *ds_u = row(_downsafety, tmp_u) + s.begin;
+        const Word *us_u = row(_upsafety, tmp_u) + s.begin;
+        for (int w = 0; w < s.count; ++w) {
+          tmp[w] |= (~used_u[w] | killed_u[w]) &
+                    (killed_u[w] | ~(ds_u[w] | us_u[w]));
+        }
+      }
+      traceRow(trace, "Earliestness", _earliestness, v, s, tmp.data());
+      stats.changes += store(_earliestness, v, s, tmp.data());
+    }
+    stats.visits = _size - 1;
+    stats.iterations = 1;
+    return stats;
+  }
+
+  // latest(i) = delay(i) & (used(i) | !AND of the successors' delay), for
+  // the words of one slice.
+  PassStats computeLatest(Slice s) {
+    PassStats stats;
+    std::vector<Word> tmp(s.count);
+    for (int i = 1; i < _size - 1; ++i) {
+      std::fill(tmp.begin(), tmp.end(), ~Word(0));
+      for (auto tmp_v : getSuccessors(i)) {
+        const Word *delay_v = row(_delay, tmp_v) + s.begin;
+        for (int w = 0; w < s.count; ++w) {
+          tmp[w] &= delay_v[w];
+        }
+      }
+      const Word *delay_i = row(_delay, i) + s.begin;
+      const Word *used_i = row(_used, i) + s.begin;
+      for (int w = 0; w < s.count; ++w) {
+        tmp[w] = delay_i[w] & (used_i[w] | ~tmp[w]);
+      }
+      stats.changes += store(_latest, i, s, tmp.data());
+    }
+    stats.visits = _size - 2;
+    stats.iterations = 1;
+    return stats;
+  }
+
+  void fillSlice(WordVector &vec, Slice s, Word value) {
+    for (int u = 0; u < _size; ++u) {
+      std::fill_n(row(vec, u) + s.begin, s.count, value);
+    }
+  }
+
+  void growAllNodes(int oldExit, int count) {
+    std::size_t offset = static_cast<std::size_t>(oldExit) * _stride;
+    std::size_t cells = static_cast<std::size_t>(count) * _stride;
+    for (auto *vec : {&_used, &_killed, &_downsafety, &_upsafety,
+                      &_earliestness, &_delay,
+                      &_latest, &_isolated}) {
+      vec->insert(vec->begin() + offset, cells, Word(0));
+    }
+  }
+
+  void setBit(WordVector &vec, int u, int expr) {
+    row(vec, u)[expr / 64] |= Word(1) << (expr % 64);
+  }
+
+  bool testBit(const WordVector &vec, int u, int expr) const {
+    return (row(vec, u)[expr / 64] >> (expr % 64)) & 1;
+  }
+
+  // Trace every expression bit of vec[n] in the slice that res changes,
+  // under name#<expression>.
+  template <typename Trace>
+  void traceRow(Trace &trace, const char *name, const WordVector &vec, int n,
+                Slice s, const Word *res) const {
+    if constexpr (!std::is_same_v<Trace, NoTrace>) {
+      const Word *old = row(vec, n) + s.begin;
+      for (int w = 0; w < s.count; ++w) {
+        Word diff = (old[w] ^ res[w]) & exprMask(s.begin + w);
+        for (; diff != 0; diff &= diff - 1) {
+          int bit = std::countr_zero(diff);
+          std::string label = std::string(name) + "#" +
+                              std::to_string((s.begin + w) * 64 + bit);
+          trace.update(label.c_str(), n, (res[w] >> bit) & 1);
+        }
+      }
+    }
+  }
+
+  // The bits of word w that belong to an expression; the rest of the last
+  // word is padding.
+  Word exprMask(int w) const {
+    int bits = _numExprs - w * 64;
+    return bits >= 64 ? ~Word(0) : (Word(1) << bits) - 1;
+  }
+
+  // Copy a freshly computed slice of a row into vec[u]; returns whether any
+  // expression bit changed. Padding bits are copied but never count.
+  bool store(WordVector &vec, int u, Slice s, const Word *res) {
+    Word *dst = row(vec, u) + s.begin;
+    Word diff = 0;
+    for (int w = 0; w < s.count; ++w) {
+      diff |= (dst[w] ^ res[w]) & exprMask(s.begin + w);
+      dst[w] = res[w];
+    }
+    return diff != 0;
+  }
+
+  // Number of nodes whose slice of vec has an expression bit other than
+  // value.
+  long countChanged(const WordVector &vec, Slice s, Word value) const {
+    long changed = 0;
+    for (int u = 0; u < _size; ++u) {
+      const Word *src = row(vec, u) + s.begin;
+      Word diff = 0;
+      for (int w = 0; w < s.count; ++w) {
+        diff |= (src[w] ^ value) & exprMask(s.begin + w);
+      }
+      changed += diff != 0;
+    }
+    return changed;
+  }
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "bit_flow_graph.h"
+#include "flow_graph.h"
+
+// Seeded generator of random CFGs with the shapes real functions have. The
+// skeleton is built from structured regions (sequences, if/else diamonds,
+// switch fan-outs and loops nested up to maxLoopDepth), so it is reducible;
+// gotoRatio then adds irregular jumps between arbitrary blocks on top.
+// Every block uses a + b with probability usedDensity and kills it with
+// probability killedDensity. Equal options always produce the same graph.
+class CFGGenerator {
+public:
+  struct Options {
+    int numNodes = 1000;
+    std::uint64_t seed = 12138;
+    double branchProb = 0.25;
+    double switchProb = 0.05;
+    int maxSwitchFanout = 8;
+    double loopProb = 0.15;
+    int maxLoopDepth = 4;
+    double gotoRatio = 0.0;
+    double usedDensity = 0.1;
+    double killedDensity = 0.05;
+  };
+
+  CFGGenerator(const Options &opts) : _opts(opts), _rng(opts.seed) {}
+
+  std::unique_ptr<FlowGraph> generate() {
+    int size = generateEdges();
+    auto g = std::make_unique<FlowGraph>(size);
+    g->addEdges(std::move(_edges));
+    std::bernoulli_distribution used(_opts.usedDensity);
+    std::bernoulli_distribution killed(_opts.killedDensity);
+    for (int i = 1; i <= size; ++i) {
+      if (used(_rng)) {
+        g->setUsed(i);
+      }
+      if (killed(_rng)) {
+        g->setKilled(i);
+      }
+    }
+    return g;
+  }
+
+  // Same CFG shapes for the bit-vector mode; every expression draws its own
+  // used/killed blocks with the configured densities.
+  std::unique_ptr<BitFlowGraph> generateBits(int numExprs) {
+    int size = generateEdges();
+    auto g = std::make_unique<BitFlowGraph>(size, numExprs);
+    g->addEdges(std::move(_edges));
+    std::bernoulli_distribution used(_opts.usedDensity);
+    std::bernoulli_distribution killed(_opts.killedDensity);
+    for (int i = 1; i <= size; ++i) {
+      for (int e = 0; e < numExprs; ++e) {
+        if (used(_rng)) {
+          g->setUsed(i, e);
+        }
+        if (killed(_rng)) {
+          g->setKilled(i, e);
+        }
+      }
+    }
+    return g;
+  }
+
+private:
+  // Placeholder for the exit node, whose index is only known at the end.
+  static constexpr int kExit = -1;
+
+  Options _opts;
+  std::mt19937_64 _rng;
+  std::vector<std::pair<int, int>> _edges;
+  int _next = 1;
+  int _budget = 0;
+
+  // Build the edge list into _edges and return the number of ordinary nodes.
+  int generateEdges() {
+    _edges.clear();
+    _next = 1;
+    _budget = std::max(_opts.numNodes, 1) - 1;
+
+    int first = _next++;
+    _edges.emplace_back(0, first);
+    region(first, kExit, _budget, 0);
+
+    int size = _next - 1;
+    int exit = size + 1;
+    for (auto &[u, v] : _edges) {
+      v = (v == kExit) ? exit : v;
+    }
+
+    std::uniform_int_distribution<int> node(1, size);
+    long gotos = static_cast<long>(_opts.gotoRatio * size);
+    for (long k = 0; k < gotos; ++k) {
+      _edges.emplace_back(node(_rng), node(_rng));
+    }
+    return size;
+  }
+
+  int newNode() {
+    --_budget;
+    return _next++;
+  }
+
+  double uniform() { return std::uniform_real_distribution<double>()(_rng); }
+
+  int split(int budget) {
+    return std::uniform_int_distribution<int>(1, budget - 1)(_rng);
+  }
+
+  // Fill the control flow between the existing nodes entry and exit using
+  // about budget new nodes. Recursion depth is bounded by the loop depth
+  // plus the (logarithmic on average) depth of the random splits.
+  void region(int entry, int exit, int budget, int depth) {
+    budget = std::min(budget, _budget);
+    if (budget <= 0) {
+      _edges.emplace_back(entry, exit);
+      return;
+    }
+
+    double r = uniform();
+    if (budget >= 3 && depth < _opts.maxLoopDepth && r < _opts.loopProb) {
+      // do-while loop: entry -> header ... latch -> header, latch -> exit;
+      // half of them also test at the header (while loop).
+      int header = newNode();
+      int latch = newNode();
+      _edges.emplace_back(entry, header);
+      region(header, latch, budget - 2, depth + 1);
+      _edges.emplace_back(latch, header);
+      _edges.emplace_back(latch, exit);
+      if (uniform() < 0.5) {
+        _edges.emplace_back(header, exit);
+      }
+      return;
+    }
+    r -= _opts.loopProb;
+    if (budget >= 3 && r < _opts.switchProb) {
+      int arms = std::uniform_int_distribution<int>(
+          2, std::max(2, std::min(_opts.maxSwitchFanout, budget)))(_rng);
+      int share = budget / arms;
+      for (int k = 0; k < arms && _budget > 0; ++k) {
+        int arm = newNode();
+        _edges.emplace_back(entry, arm);
+        int armBudget = (k == arms - 1) ? budget - share * k : share;
+        region(arm, exit, armBudget - 1, depth);
+      }
+      return;
+    }
+    r -= _opts.switchProb;
+    if (budget >= 2 && r < _opts.branchProb) {
+      bool hasElse = uniform() < 0.5;
+      int b1 = hasElse ? split(budget) : budget;
+      int thenNode = newNode();
+      _edges.emplace_back(entry, thenNode);
+      region(thenNode, exit, b1 - 1, depth);
+      if (hasElse && _budget > 0) {
+        int elseNode = newNode();
+        _edges.emplace_back(entry, elseNode);
+        region(elseNode, exit, budget - b1 - 1, depth);
+      } else {
+        _edges.emplace_back(entry, exit);
+      }
+      return;
+    }
+
+    // Straight-line sequence entry -> ... -> mid -> ... -> exit.
+    int mid = newNode();
+    if (budget == 1) {
+      _edges.emplace_back(entry, mid);
+      _edges.emplace_back(mid, exit);
+      return;
+    }
+    int b1 = split(budget);
+    region(entry, mid, b1 - 1, depth);
+    region(mid, exit, budget - b1, depth);
+  }
+};
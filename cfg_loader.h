@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "flow_graph.h"
+
+// Reads a file in large fixed-size chunks and hands out one line at a time
+// as a view into the chunk buffer; only a line that straddles two chunks is
+// moved. Lines stay valid until the next call to nextLine().
+class LineReader {
+public:
+  LineReader(const std::string &Filepath, std::size_t chunkSize = 1 << 20)
+      : _file(std::fopen(Filepath.c_str(), "rb")), _buffer(chunkSize) {
+    if (_file == nullptr) {
+      throw std::runtime_error("cannot open " + Filepath);
+    }
+  }
+
+  ~LineReader() { std::fclose(_file); }
+
+  LineReader(const LineReader &) = delete;
+  LineReader &operator=(const LineReader &) = delete;
+
+  bool nextLine(std::string_view &line) {
+    while (true) {
+      const char *begin = _buffer.data() + _pos;
+      const char *end = _buffer.data() + _end;
+      const char *nl =
+          static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+      if (nl != nullptr) {
+        line = {begin, static_cast<std::size_t>(nl - begin)};
+        _pos = nl - _buffer.data() + 1;
+        ++_lineNo;
+        return true;
+      }
+      if (_eof) {
+        if (begin == end) {
+          return false;
+        }
+        line = {begin, static_cast<std::size_t>(end - begin)};
+        _pos = _end;
+        ++_lineNo;
+        return true;
+      }
+      refill();
+    }
+  }
+
+  long getLineNo() const { return _lineNo; }
+
+private:
+  std::FILE *_file;
+  std::vector<char> _buffer;
+  std::size_t _pos = 0;
+  std::size_t _end = 0;
+  bool _eof = false;
+  long _lineNo = 0;
+
+  void refill() {
+    std::size_t rest = _end - _pos;
+    std::memmove(_buffer.data(), _buffer.data() + _pos, rest);
+    if (rest == _buffer.size()) {
+      _buffer.resize(_buffer.size() * 2);
+    }
+    _pos = 0;
+    _end = rest;
+    std::size_t got =
+        std::fread(_buffer.data() + _end, 1, _buffer.size() - _end, _file);
+    _end += got;
+    _eof = (got == 0);
+  }
+};
+
+// Builds a FlowGraph from a textual dump. Two formats are understood:
+//
+//   Line format (one record per line, '#' starts a comment):
+//     n <count>      optional hint: number of ordinary nodes
+//     e <u> <v>      edge u -> v
+//     u <node>       node uses a + b
+//     k <node>       node kills a + b
+//     i <node> <op>  append an instruction to the block, where <op> is
+//                      u  a use of a + b
+//                      k  a kill of a + b (a := c)
+//                      o  an instruction that touches neither
+//                      a  the assignment x := a + b that partial dead
+//                         code elimination sinks; a use for LCM
+//                      x  a read of x
+//   Node 0 is the entry and the largest id is the exit, as in the testN()
+//   graphs.
+//
+//   DOT: the subset written by drawBCM()/drawALCM()/drawLCM(). Those files
+//   omit entry and exit, so the entry is connected to the lowest-numbered
+//   block (which may be a loop header) and to every other node without
+//   predecessors, and every node without successors to the exit. A dump
+//   with blocks the entry still does not reach is rejected.
+//
+// Both parsers are single pass: records are staged in flat vectors while the
+// largest node id is tracked, and the graph is sized once at the end.
+class CFGLoader {
+public:
+  static std::unique_ptr<FlowGraph> loadText(const std::string &Filepath) {
+    LineReader reader(Filepath);
+    Staging st;
+    std::string_view line;
+    while (reader.nextLine(line)) {
+      skipSpaces(line);
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      char tag = line[0];
+      line.remove_prefix(1);
+      int a = 0;
+      int b = 0;
+      bool ok = parseInt(line, a);
+      switch (tag) {
+      case 'n':
+        st.hint = a;
+        break;
+      case 'e':
+        ok = ok && parseInt(line, b);
+        st.edges.emplace_back(a, b);
+        st.maxId = std::max({st.maxId, a, b});
+        break;
+      case 'u':
+        st.used.push_back(a);
+        st.maxId = std::max(st.maxId, a);
+        break;
+      case 'k':
+        st.killed.push_back(a);
+        st.maxId = std::max(st.maxId, a);
+        break;
+      case 'i':
+        skipSpaces(line);
+        if (line.empty() || std::string_view("ukoax").find(line[0]) ==
+                                 std::string_view::npos) {
+          ok = false;
+          break;
+        }
+        st.code.emplace_back(a, line[0] == 'u'   ? FlowGraph::Instr::Use
+                                : line[0] == 'k' ? FlowGraph::Instr::Kill
+                                : line[0] == 'a' ? FlowGraph::Instr::Assign
+                                : line[0] == 'x' ? FlowGraph::Instr::UseX
+                                                 : FlowGraph::Instr::Other);
+        st.maxId = std::max(st.maxId, a);
+        break;
+      default:
+        ok = false;
+      }
+      if (!ok) {
+        throw std::runtime_error(Filepath + ":" +
+                                 std::to_string(reader.getLineNo()) +
+                                 ": malformed record");
+      }
+    }
+    return st.build(std::max(st.maxId - 1, st.hint));
+  }
+
+  static std::unique_ptr<FlowGraph> loadDot(const std::string &Filepath) {
+    LineReader reader(Filepath);
+    Staging st;
+    std::string_view line;
+    while (reader.nextLine(line)) {
+      skipSpaces(line);
+      int u = 0;
+      if (!consume(line, "BB") || !parseInt(line, u)) {
+        continue;
+      }
+      st.maxId = std::max(st.maxId, u);
+      int v = 0;
+      if (consume(line, "->")) {
+        if (!consume(line, "BB") || !parseInt(line, v)) {
+          throw std::runtime_error(Filepath + ":" +
+                                   std::to_string(reader.getLineNo()) +
+                                   ": malformed edge");
+        }
+        st.edges.emplace_back(u, v);
+        st.maxId = std::max(st.maxId, v);
+        continue;
+      }
+      std::size_t label = line.find("label=\"");
+      if (label == std::string_view::npos) {
+        continue;
+      }
+      std::string_view text = line.substr(label + 7);
+      text = text.substr(0, text.find('"'));
+      if (text.find("... := a + b") != std::string_view::npos ||
+          text.find("... := h") != std::string_view::npos) {
+        st.used.push_back(u);
+      }
+      if (text.find("a := c") != std::string_view::npos) {
+        st.killed.push_back(u);
+      }
+    }
+
+    // Reattach the entry (0) and exit (maxId + 1) nodes.
+    int exit = st.maxId + 1;
+    std::vector<char> hasPred(exit + 1, 0);
+    std::vector<char> hasSucc(exit + 1, 0);
+    for (auto [u, v] : st.edges) {
+      hasSucc[u] = 1;
+      hasPred[v] = 1;
+    }
+    for (int i = 1; i < exit; ++i) {
+      if (i == 1 || !hasPred[i]) {
+        st.edges.emplace_back(0, i);
+      }
+      if (!hasSucc[i]) {
+        st.edges.emplace_back(i, exit);
+      }
+    }
+    if (int u = findUnreachable(st.edges, exit + 1); u >= 0) {
+      throw std::runtime_error(Filepath + ": BB" + std::to_string(u) +
+                               " is not reachable from the entry");
+    }
+    return st.build(exit - 1);
+  }
+
+private:
+  struct Staging {
+    std::vector<std::pair<int, int>> edges;
+    std::vector<int> used;
+    std::vector<int> killed;
+    std::vector<std::pair<int, FlowGraph::Instr>> code;
+    int maxId = 0;
+    int hint = 0;
+
+    std::unique_ptr<FlowGraph> build(int size) {
+      auto g = std::make_unique<FlowGraph>(size);
+      g->addEdges(std::move(edges));
+      for (int u : used) {
+        g->setUsed(u);
+      }
+      for (int u : killed) {
+        g->setKilled(u);
+      }
+      for (auto [u, instr] : code) {
+        g->addInstruction(u, instr);
+      }
+      return g;
+    }
+  };
+
+  // Some node other than the exit (the last one) that the entry does not
+  // reach, or -1. The exit may be unreachable: a CFG can end in a loop.
+  static int findUnreachable(const std::vector<std::pair<int, int>> &edges,
+                             int size) {
+    std::vector<int> offsets(size + 1, 0), succs(edges.size());
+    for (auto [u, v] : edges) {
+      ++offsets[u + 1];
+    }
+    for (int i = 0; i < size; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (auto [u, v] : edges) {
+      succs[fill[u]++] = v;
+    }
+    std::vector<char> reached(size, 0);
+    std::vector<int> stack = {0};
+    reached[0] = 1;
+    while (!stack.empty()) {
+      int u = stack.back();
+      stack.pop_back();
+      for (int k = offsets[u]; k < offsets[u + 1]; ++k) {
+        if (!reached[succs[k]]) {
+          reached[succs[k]] = 1;
+          stack.push_back(succs[k]);
+        }
+      }
+    }
+    auto it = std::find(reached.begin(), reached.end() - 1, 0);
+    return it == reached.end() - 1 ? -1
+                                   : static_cast<int>(it - reached.begin());
+  }
+
+  static void skipSpaces(std::string_view &line) {
+    while (!line.empty() && (line[0] == ' ' || line[0] == '\t')) {
+      line.remove_prefix(1);
+    }
+  }
+
+  static bool consume(std::string_view &line, std::string_view prefix) {
+    if (line.substr(0, prefix.size()) != prefix) {
+      return false;
+    }
+    line.remove_prefix(prefix.size());
+    return true;
+  }
+
+  static bool parseInt(std::string_view &line, int &value) {
+    skipSpaces(line);
+    auto [ptr, ec] =
+        std::from_chars(line.data(), line.data() + line.size(), value);
+    if (ec != std::errc() || value < 0) {
+      return false;
+    }
+    line.remove_prefix(ptr - line.data());
+    return true;
+  }
+};
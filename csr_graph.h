@@ -0,0 +1,636 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "pass_stats.h"
+
+// Worklist shared by the fixpoint solvers. In the Ordered policy nodes are
+// popped in ascending rank (reverse postorder for forward problems,
+// postorder for backward ones) and a node already on the list is never
+// queued twice. FIFO is the plain queue the solvers started out with:
+// nodes come back in push order, duplicates included. It is kept as the
+// baseline for visit counts (see LCMBench --worklist).
+class Worklist {
+public:
+  enum class Order { Ordered, FIFO };
+
+  Worklist(std::span<const int> rank, Order order = Order::Ordered)
+      : _rank(rank), _order(order), _inList(rank.size(), 0) {}
+
+  void push(int u) {
+    ++_pushes;
+    if (_order == Order::FIFO) {
+      _queue.push(u);
+      return;
+    }
+    if (_inList[u]) {
+      return;
+    }
+    _inList[u] = 1;
+    _heap.emplace(_rank[u], u);
+  }
+
+  int pop() {
+    int rank, u;
+    if (_order == Order::FIFO) {
+      u = _queue.front();
+      _queue.pop();
+      rank = _rank[u];
+    } else {
+      std::tie(rank, u) = _heap.top();
+      _heap.pop();
+      _inList[u] = 0;
+    }
+    // A pop below the previous one's rank starts another sweep.
+    if (_visits == 0 || rank < _lastRank) {
+      ++_sweeps;
+    }
+    _lastRank = rank;
+    ++_visits;
+    return u;
+  }
+
+  bool empty() const {
+    return _order == Order::FIFO ? _queue.empty() : _heap.empty();
+  }
+
+  long getVisits() const { return _visits; }
+
+  long getPushes() const { return _pushes; }
+
+  // Passes over the nodes in rank order so far: 1 if every node was popped
+  // after all lower-ranked ones, one more for every wrap-around.
+  long getSweeps() const { return _sweeps; }
+
+private:
+  std::span<const int> _rank;
+  Order _order;
+  std::vector<char> _inList;
+  std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>,
+                      std::greater<>>
+      _heap;
+  std::queue<int> _queue;
+  long _visits = 0;
+  long _pushes = 0;
+  long _sweeps = 0;
+  int _lastRank = 0;
+};
+
+// Control flow skeleton shared by the single-expression FlowGraph and the
+// bit-vector BitFlowGraph: edges are collected by addEdge() and packed into
+// forward/reverse CSR arrays by finalize().
+class CSRGraph {
+public:
+  // How the analyses iterate: one worklist over the whole graph, one
+  // strongly connected component at a time in (reverse) topological order,
+  // iterating only inside cyclic components, or not at all: Elimination
+  // solves reducible graphs by T1/T2 reduction (see EliminationSolver) and
+  // falls back to the worklist on irreducible ones.
+  enum class Engine { Worklist, SCC, Elimination };
+
+  CSRGraph(int size) : _size(size) {}
+
+  // Before finalize() edges are only collected. A finalized graph is
+  // patched in place instead: the edge is spliced into the sorted lists of
+  // u and v (see Adjacency), which costs O(degree) amortized rather than a
+  // rebuild. The RPO/postorder ranks are kept; they only steer worklist
+  // priorities. Spans returned by the queries are invalidated.
+  void addEdge(int u, int v) {
+    if (!_finalized) {
+      _edgeList.emplace_back(u, v);
+      return;
+    }
+    _succ.insert(u, v);
+    _pred.insert(v, u);
+    _sccValid = false;
+  }
+
+  void removeEdge(int u, int v) {
+    if (!_finalized) {
+      std::erase(_edgeList, std::make_pair(u, v));
+      return;
+    }
+    _succ.erase(u, v);
+    _pred.erase(v, u);
+    _sccValid = false;
+  }
+
+  // Bulk form of addEdge(); takes over the vector when no edges exist yet.
+  void addEdges(std::vector<std::pair<int, int>> &&edges) {
+    if (_finalized) {
+      // Go back to collecting: the CSR arrays are rebuilt by finalize().
+      _edgeList.clear();
+      for (int u = 0; u < _size; ++u) {
+        for (int v : _succ.of(u)) {
+          _edgeList.emplace_back(u, v);
+        }
+      }
+    }
+    if (_edgeList.empty()) {
+      _edgeList = std::move(edges);
+    } else {
+      _edgeList.insert(_edgeList.end(), edges.begin(), edges.end());
+    }
+    _finalized = false;
+  }
+
+  // Build the CSR successor/predecessor arrays from the collected edge list.
+  // Called once after all addEdge() calls; later calls only pack the lists
+  // that edits have moved (see Adjacency), or rebuild them if addEdges()
+  // was called in between.
+  void finalize() {
+    if (_finalized) {
+      _succ.pack();
+      _pred.pack();
+      return;
+    }
+    // Bucket the edges by source, then by target via the predecessor
+    // arrays and back again: two stable counting sorts that leave every
+    // successor list in ascending order (the order the old matrix scan
+    // produced) without a comparison sort, so duplicates end up adjacent.
+    std::vector<int> &offsets = _succ.begin;
+    std::vector<int> &succs = _succ.items;
+    offsets.assign(_size + 1, 0);
+    for (auto [u, v] : _edgeList) {
+      ++offsets[u + 1];
+    }
+    for (int i = 0; i < _size; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+    succs.resize(_edgeList.size());
+    std::vector<int> succFill(offsets.begin(), offsets.end() - 1);
+    for (auto [u, v] : _edgeList) {
+      succs[succFill[u]++] = v;
+    }
+    _succ.setPacked();
+    buildPredecessors();
+    std::copy(offsets.begin(), offsets.end() - 1, succFill.begin());
+    for (int v = 0; v < _size; ++v) {
+      for (int u : _pred.of(v)) {
+        succs[succFill[u]++] = v;
+      }
+    }
+
+    std::size_t out = 0;
+    for (int u = 0; u < _size; ++u) {
+      int begin = offsets[u];
+      offsets[u] = out;
+      for (int k = begin; k < offsets[u + 1]; ++k) {
+        if (k == begin || succs[k] != succs[k - 1]) {
+          succs[out++] = succs[k];
+        }
+      }
+    }
+    std::vector<std::pair<int, int>>().swap(_edgeList);
+    offsets[_size] = out;
+    succs.resize(out);
+    _succ.setPacked();
+    buildPredecessors();
+    computeOrders();
+    _finalized = true;
+    _sccValid = false;
+  }
+
+  std::span<const int> getPrecessors(int v) const {
+    assert(_finalized && "CSRGraph::finalize() must run before queries");
+    return _pred.of(v);
+  }
+
+  std::span<const int> getSuccessors(int u) const {
+    assert(_finalized && "CSRGraph::finalize() must run before queries");
+    return _succ.of(u);
+  }
+
+  // Position of each node in reverse postorder / postorder of a DFS from the
+  // entry node. Used as worklist priorities for forward / backward problems.
+  std::span<const int> getRPORank() const {
+    assert(_finalized && "CSRGraph::finalize() must run before queries");
+    return _rpoRank;
+  }
+
+  std::span<const int> getPostOrderRank() const {
+    assert(_finalized && "CSRGraph::finalize() must run before queries");
+    return _poRank;
+  }
+
+  // Pop order of the worklists the solvers build over this graph.
+  void setWorklistOrder(Worklist::Order order) { _worklistOrder = order; }
+
+  Worklist::Order getWorklistOrder() const { return _worklistOrder; }
+
+  void setEngine(Engine engine) { _engine = engine; }
+
+  Engine getEngine() const { return _engine; }
+
+  // Counters of the latest run of every pass on this graph: the analyses
+  // (and their incremental ".recompute" runs), the placements and the
+  // writers. Always collected; see PassStats.
+  const PassStatsLog &getPassStats() const { return _passStats; }
+
+  void clearPassStats() { _passStats.clear(); }
+
+  void writePassStats(std::ostream &outs, std::string_view graph = {}) const {
+    _passStats.writeJSON(outs, graph);
+  }
+
+  int getSize() const { return _size; }
+
+  // Strongly connected components, computed on first use after each change
+  // of the edges. Components are numbered in the order Tarjan's algorithm
+  // completes them, which is a reverse topological order: every edge leaving
+  // component c goes to a component with a smaller number.
+  void computeSCCs() {
+    finalize();
+    if (_sccValid) {
+      return;
+    }
+    std::vector<int> index(_size, -1);
+    std::vector<int> low(_size, 0);
+    std::vector<char> onStack(_size, 0);
+    std::vector<int> stack;
+    std::vector<std::pair<int, int>> calls;
+    int counter = 0;
+    _sccOf.assign(_size, -1);
+    _sccOffsets.assign(1, 0);
+    _sccNodes.clear();
+    _sccNodes.reserve(_size);
+
+    auto open = [&](int u) {
+      index[u] = low[u] = counter++;
+      stack.push_back(u);
+      onStack[u] = 1;
+      calls.emplace_back(u, _succ.begin[u]);
+    };
+    for (int root = 0; root < _size; ++root) {
+      if (index[root] >= 0) {
+        continue;
+      }
+      open(root);
+      while (!calls.empty()) {
+        auto [u, next] = calls.back();
+        if (next < _succ.end[u]) {
+          ++calls.back().second;
+          int v = _succ.items[next];
+          if (index[v] < 0) {
+            open(v);
+          } else if (onStack[v]) {
+            low[u] = std::min(low[u], index[v]);
+          }
+          continue;
+        }
+        calls.pop_back();
+        if (!calls.empty()) {
+          int parent = calls.back().first;
+          low[parent] = std::min(low[parent], low[u]);
+        }
+        if (low[u] == index[u]) {
+          int id = static_cast<int>(_sccOffsets.size()) - 1;
+          int w;
+          do {
+            w = stack.back();
+            stack.pop_back();
+            onStack[w] = 0;
+            _sccOf[w] = id;
+            _sccNodes.push_back(w);
+          } while (w != u);
+          _sccOffsets.push_back(_sccNodes.size());
+        }
+      }
+    }
+    _sccValid = true;
+  }
+
+  int getSCCCount() const {
+    assert(_sccValid && "CSRGraph::computeSCCs() must run before queries");
+    return static_cast<int>(_sccOffsets.size()) - 1;
+  }
+
+  int getSCC(int u) const {
+    assert(_sccValid && "CSRGraph::computeSCCs() must run before queries");
+    return _sccOf[u];
+  }
+
+  std::span<const int> getSCCNodes(int c) const {
+    assert(_sccValid && "CSRGraph::computeSCCs() must run before queries");
+    return {_sccNodes.data() + _sccOffsets[c],
+            _sccNodes.data() + _sccOffsets[c + 1]};
+  }
+
+  // Whether node u was inserted by splitCriticalEdges(), and if so the edge
+  // (in current node numbering) it was placed on.
+  bool isSynthetic(int u) const {
+    return u < static_cast<int>(_splitEdges.size()) &&
+           _splitEdges[u].first >= 0;
+  }
+
+  std::pair<int, int> getSplitEdge(int u) const { return _splitEdges[u]; }
+
+  // Print a node of a placement list; synthetic nodes also name their edge.
+  void printNode(int u, std::ostream &outs = std::cout) const {
+    outs << u;
+    if (isSynthetic(u)) {
+      outs << "(" << _splitEdges[u].first << "->" << _splitEdges[u].second
+           << ")";
+    }
+    outs << ", ";
+  }
+
+protected:
+  int _size;
+  PassStatsLog _passStats;
+  Engine _engine = Engine::Worklist;
+
+  // Run solve(worklist, scc) over the nodes first..last. The worklist
+  // engine queues them all and lets changes spread anywhere (scc = -1). The
+  // SCC engine visits the components so that all successors (backward
+  // problems) or predecessors (forward ones) of a component are final
+  // before it, and solve() only requeues nodes inside the current one, so
+  // an acyclic component costs a single evaluation.
+  template <typename Solve>
+  void runEngine(Worklist &worklist, bool forward, int first, int last,
+                 Solve solve) {
+    if (_engine == Engine::Worklist) {
+      for (int i = first; i <= last; ++i) {
+        worklist.push(i);
+      }
+      solve(worklist, -1);
+      return;
+    }
+    computeSCCs();
+    int count = getSCCCount();
+    for (int k = 0; k < count; ++k) {
+      int c = forward ? count - 1 - k : k;
+      for (int u : getSCCNodes(c)) {
+        if (u >= first && u <= last) {
+          worklist.push(u);
+        }
+      }
+      solve(worklist, c);
+    }
+  }
+
+
+  bool inScope(int u, int scc) const { return scc < 0 || getSCC(u) == scc; }
+
+  bool isCriticalEdge(int u, int v) const {
+    return _succ.degree(u) > 1 && _pred.degree(v) > 1;
+  }
+
+  // Insert a fresh node on every edge u->v selected by shouldSplit(u, v),
+  // which sees the degrees of the graph before splitting. The new CSR arrays
+  // are produced in a single linear pass over the old ones; synthetic nodes
+  // take the indices from the old exit onwards and the exit moves to the new
+  // last index. Returns the number of inserted nodes.
+  template <typename ShouldSplit> int splitEdgesCSR(ShouldSplit shouldSplit) {
+    finalize();
+    int oldExit = _size - 1;
+    int count = 0;
+    for (int u = 0; u < oldExit; ++u) {
+      for (int v : _succ.of(u)) {
+        count += shouldSplit(u, v);
+      }
+    }
+    if (count == 0) {
+      return 0;
+    }
+
+    int newSize = _size + count;
+    int newExit = newSize - 1;
+    auto remap = [&](int x) { return x == oldExit ? newExit : x; };
+
+    std::vector<int> succOffsets(newSize + 1, 0);
+    std::vector<int> succs;
+    succs.reserve(_succ.items.size() + count);
+    std::vector<std::pair<int, int>> synthEdges;
+    synthEdges.reserve(count);
+    int nextSynth = oldExit;
+    for (int u = 0; u < oldExit; ++u) {
+      for (int v : _succ.of(u)) {
+        if (shouldSplit(u, v)) {
+          succs.push_back(nextSynth++);
+          synthEdges.emplace_back(u, remap(v));
+        } else {
+          succs.push_back(remap(v));
+        }
+      }
+      succOffsets[u + 1] = succs.size();
+    }
+    for (int i = 0; i < count; ++i) {
+      succs.push_back(synthEdges[i].second);
+      succOffsets[oldExit + i + 1] = succs.size();
+    }
+    for (int v : _succ.of(oldExit)) {
+      succs.push_back(remap(v));
+    }
+    succOffsets[newSize] = succs.size();
+
+    _splitEdges.resize(_size, {-1, -1});
+    for (auto &[u, v] : _splitEdges) {
+      v = (u >= 0) ? remap(v) : v;
+    }
+    _splitEdges.insert(_splitEdges.begin() + oldExit, synthEdges.begin(),
+                       synthEdges.end());
+
+    _size = newSize;
+    _succ.begin = std::move(succOffsets);
+    _succ.items = std::move(succs);
+    _succ.setPacked();
+    buildPredecessors();
+    computeOrders();
+    _sccValid = false;
+    return count;
+  }
+
+  // Split every critical edge u->v (u has several successors, v several
+  // predecessors).
+  int splitCriticalEdgesCSR() {
+    return splitEdgesCSR(
+        [this](int u, int v) { return isCriticalEdge(u, v); });
+  }
+
+  // Split critical edges, plus the join edges u->v whose source kills some
+  // expression. Code motion inserts at node entries, so an insertion that
+  // must sit after the kill in u and before the join at v needs a node of
+  // its own there; join edges from transparent sources do not, since their
+  // insertions can move to the entry of u instead. The entry node is no
+  // insertion point either, so its join edges (into a loop header that is
+  // the first block) are split as if it killed everything.
+  template <typename IsKilled> int makeTRefinedCSR(IsKilled isKilled) {
+    int exit = _size - 1;
+    return splitEdgesCSR([&](int u, int v) {
+      bool join = _pred.degree(v) > 1;
+      return isCriticalEdge(u, v) ||
+             (join && v != exit && (u == 0 || isKilled(u)));
+    });
+  }
+
+private:
+  // One direction of the edges: the sorted list of node u is items[begin[u]
+  // .. end[u]), with room for edits up to limit[u]. finalize() and the
+  // edge splitters lay the lists out back to back without room (CSR, with
+  // begin[_size] the number of edges). An edit that finds no room moves the
+  // list to the back of items with twice its length as room, so inserting
+  // or removing an edge costs O(degree) amortized and never shifts the
+  // lists of other nodes. The space left behind is reclaimed by pack(),
+  // from finalize() or once it makes up half of items.
+  struct Adjacency {
+    std::vector<int> begin;
+    std::vector<int> end;
+    std::vector<int> limit;
+    std::vector<int> items;
+    std::size_t garbage = 0;
+
+    std::span<const int> of(int u) const {
+      return {items.data() + begin[u], items.data() + end[u]};
+    }
+
+    int degree(int u) const { return end[u] - begin[u]; }
+
+    // After begin (size + 1 offsets) and items were filled back to back.
+    void setPacked() {
+      end.assign(begin.begin() + 1, begin.end());
+      limit = end;
+      garbage = 0;
+    }
+
+    // Insert v into the list of u unless it is there.
+    void insert(int u, int v) {
+      auto first = items.begin() + begin[u];
+      auto last = items.begin() + end[u];
+      int at = std::lower_bound(first, last, v) - items.begin();
+      if (at != end[u] && items[at] == v) {
+        return;
+      }
+      if (end[u] == limit[u]) {
+        int length = end[u] - begin[u];
+        int room = std::max(4, 2 * length);
+        int moved = static_cast<int>(items.size());
+        items.resize(moved + room);
+        std::copy(items.begin() + begin[u], items.begin() + end[u],
+                  items.begin() + moved);
+        garbage += limit[u] - begin[u];
+        at += moved - begin[u];
+        begin[u] = moved;
+        end[u] = moved + length;
+        limit[u] = moved + room;
+      }
+      std::copy_backward(items.begin() + at, items.begin() + end[u],
+                         items.begin() + end[u] + 1);
+      items[at] = v;
+      ++end[u];
+      if (2 * garbage > items.size()) {
+        pack();
+      }
+    }
+
+    void erase(int u, int v) {
+      auto first = items.begin() + begin[u];
+      auto last = items.begin() + end[u];
+      auto it = std::lower_bound(first, last, v);
+      if (it == last || *it != v) {
+        return;
+      }
+      std::copy(it + 1, last, it);
+      --end[u];
+    }
+
+    // Lay the lists out back to back again if any has moved.
+    void pack() {
+      if (garbage == 0) {
+        return;
+      }
+      int size = static_cast<int>(end.size());
+      std::vector<int> packedItems;
+      packedItems.reserve(items.size() - garbage);
+      for (int u = 0; u < size; ++u) {
+        int first = begin[u];
+        begin[u] = static_cast<int>(packedItems.size());
+        packedItems.insert(packedItems.end(), items.begin() + first,
+                           items.begin() + end[u]);
+      }
+      begin[size] = static_cast<int>(packedItems.size());
+      items = std::move(packedItems);
+      setPacked();
+    }
+  };
+
+  std::vector<std::pair<int, int>> _edgeList;
+  bool _finalized = false;
+  Adjacency _succ;
+  Adjacency _pred;
+  std::vector<int> _rpoRank;
+  std::vector<int> _poRank;
+  Worklist::Order _worklistOrder = Worklist::Order::Ordered;
+  std::vector<std::pair<int, int>> _splitEdges;
+  bool _sccValid = false;
+  std::vector<int> _sccOf;
+  std::vector<int> _sccOffsets;
+  std::vector<int> _sccNodes;
+
+  // Fill the predecessor CSR from the successor CSR. Walking sources in
+  // ascending order keeps every predecessor list sorted.
+  void buildPredecessors() {
+    std::vector<int> &offsets = _pred.begin;
+    offsets.assign(_size + 1, 0);
+    for (int u = 0; u < _size; ++u) {
+      for (int v : _succ.of(u)) {
+        ++offsets[v + 1];
+      }
+    }
+    for (int i = 0; i < _size; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+    _pred.items.resize(offsets[_size]);
+    std::vector<int> predFill(offsets.begin(), offsets.end() - 1);
+    for (int u = 0; u < _size; ++u) {
+      for (int v : _succ.of(u)) {
+        _pred.items[predFill[v]++] = u;
+      }
+    }
+    _pred.setPacked();
+  }
+
+  // Iterative DFS from the entry node; nodes unreachable from it (e.g. the
+  // exit of a graph with an infinite loop) are ordered by further DFS roots.
+  void computeOrders() {
+    std::vector<int> postorder;
+    postorder.reserve(_size);
+    std::vector<char> visited(_size, 0);
+    std::vector<std::pair<int, int>> stack;
+    for (int root = 0; root < _size; ++root) {
+      if (visited[root]) {
+        continue;
+      }
+      visited[root] = 1;
+      stack.emplace_back(root, _succ.begin[root]);
+      while (!stack.empty()) {
+        auto &[u, next] = stack.back();
+        if (next < _succ.end[u]) {
+          int v = _succ.items[next++];
+          if (!visited[v]) {
+            visited[v] = 1;
+            stack.emplace_back(v, _succ.begin[v]);
+          }
+        } else {
+          postorder.push_back(u);
+          stack.pop_back();
+        }
+      }
+    }
+    _poRank.assign(_size, 0);
+    _rpoRank.assign(_size, 0);
+    for (int k = 0; k < _size; ++k) {
+      _poRank[postorder[k]] = k;
+      _rpoRank[postorder[k]] = _size - 1 - k;
+    }
+  }
+};
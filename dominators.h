@@ -0,0 +1,185 @@
+#pragma once
+
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "csr_graph.h"
+
+// Dominator tree of a finalized CSRGraph by the iterative algorithm of
+// Cooper, Harvey and Kennedy over a postorder of the nodes reachable from
+// the entry, plus the dominance frontier of every node (Cytron et al.,
+// walking up the tree from the predecessors of every join). Nodes that the
+// entry does not reach are not in the tree. The tree is built once per CFG
+// and only read afterwards, so sparse passes over many expressions can
+// share it; dominance between two nodes is an O(1) test on the preorder
+// intervals of the tree.
+class DominatorTree {
+public:
+  explicit DominatorTree(const CSRGraph &g)
+      : _size(g.getSize()), _po(_size, -1), _idom(_size, -1),
+        _pre(_size, -1), _last(_size, -1) {
+    computeIdoms(g, computePostorder(g));
+    computePreorder();
+    computeFrontiers(g);
+  }
+
+  bool isReachable(int u) const { return _pre[u] >= 0; }
+
+  // Immediate dominator; -1 for the entry and for unreachable nodes.
+  int getIdom(int u) const { return _idom[u]; }
+
+  // Position of u in a preorder walk of the tree; -1 if unreachable.
+  int getPreorder(int u) const { return _pre[u]; }
+
+  // Whether a dominates b (every node dominates itself).
+  bool dominates(int a, int b) const {
+    return _pre[b] >= 0 && _pre[a] <= _pre[b] && _pre[b] <= _last[a];
+  }
+
+  std::span<const int> getFrontier(int u) const {
+    return {_frontiers.data() + _frontierOffsets[u],
+            _frontiers.data() + _frontierOffsets[u + 1]};
+  }
+
+private:
+  int _size;
+  std::vector<int> _po;
+  std::vector<int> _idom;
+  // Preorder number of every node and the largest one in its subtree.
+  std::vector<int> _pre;
+  std::vector<int> _last;
+  std::vector<int> _frontierOffsets;
+  std::vector<int> _frontiers;
+
+  // Iterative DFS from the entry; returns the nodes in postorder.
+  std::vector<int> computePostorder(const CSRGraph &g) {
+    std::vector<int> postorder;
+    std::vector<char> visited(_size, 0);
+    std::vector<std::pair<int, std::size_t>> stack = {{0, 0}};
+    visited[0] = 1;
+    while (!stack.empty()) {
+      auto &[u, next] = stack.back();
+      auto succs = g.getSuccessors(u);
+      if (next < succs.size()) {
+        int v = succs[next++];
+        if (!visited[v]) {
+          visited[v] = 1;
+          stack.emplace_back(v, 0);
+        }
+        continue;
+      }
+      _po[u] = static_cast<int>(postorder.size());
+      postorder.push_back(u);
+      stack.pop_back();
+    }
+    return postorder;
+  }
+
+  // Sweeps in reverse postorder until no immediate dominator changes. The
+  // entry is its own dominator while solving, so intersect() stops there.
+  void computeIdoms(const CSRGraph &g, const std::vector<int> &postorder) {
+    _idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (int k = static_cast<int>(postorder.size()) - 2; k >= 0; --k) {
+        int u = postorder[k];
+        int idom = -1;
+        for (int p : g.getPrecessors(u)) {
+          if (_idom[p] < 0) {
+            continue;
+          }
+          idom = idom < 0 ? p : intersect(p, idom);
+        }
+        if (idom != _idom[u]) {
+          _idom[u] = idom;
+          changed = true;
+        }
+      }
+    }
+    _idom[0] = -1;
+  }
+
+  int intersect(int a, int b) const {
+    while (a != b) {
+      while (_po[a] < _po[b]) {
+        a = _idom[a];
+      }
+      while (_po[b] < _po[a]) {
+        b = _idom[b];
+      }
+    }
+    return a;
+  }
+
+  void computePreorder() {
+    std::vector<int> offsets(_size + 1, 0), children;
+    for (int u = 1; u < _size; ++u) {
+      if (_idom[u] >= 0) {
+        ++offsets[_idom[u] + 1];
+      }
+    }
+    for (int u = 0; u < _size; ++u) {
+      offsets[u + 1] += offsets[u];
+    }
+    children.resize(offsets[_size]);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int u = 1; u < _size; ++u) {
+      if (_idom[u] >= 0) {
+        children[fill[_idom[u]]++] = u;
+      }
+    }
+
+    int counter = 0;
+    std::vector<std::pair<int, int>> stack = {{0, offsets[0]}};
+    _pre[0] = counter++;
+    while (!stack.empty()) {
+      auto &[u, next] = stack.back();
+      if (next < offsets[u + 1]) {
+        int v = children[next++];
+        _pre[v] = counter++;
+        stack.emplace_back(v, offsets[v]);
+        continue;
+      }
+      _last[u] = counter - 1;
+      stack.pop_back();
+    }
+  }
+
+  // v is in the frontier of every node on the tree path from a predecessor
+  // of v up to, but excluding, the immediate dominator of v.
+  void computeFrontiers(const CSRGraph &g) {
+    std::vector<std::pair<int, int>> pairs;
+    // The last v added to the frontier of each node; once a walk reaches a
+    // node that has v already, the rest of its path has it too.
+    std::vector<int> added(_size, -1);
+    for (int v = 0; v < _size; ++v) {
+      auto preds = g.getPrecessors(v);
+      if (preds.size() < 2 || !isReachable(v)) {
+        continue;
+      }
+      for (int p : preds) {
+        for (int runner = p; runner >= 0 && isReachable(runner) &&
+                             runner != _idom[v] && added[runner] != v;
+             runner = _idom[runner]) {
+          added[runner] = v;
+          pairs.emplace_back(runner, v);
+        }
+      }
+    }
+    _frontierOffsets.assign(_size + 1, 0);
+    for (auto [u, v] : pairs) {
+      ++_frontierOffsets[u + 1];
+    }
+    for (int u = 0; u < _size; ++u) {
+      _frontierOffsets[u + 1] += _frontierOffsets[u];
+    }
+    _frontiers.resize(pairs.size());
+    std::vector<int> fill(_frontierOffsets.begin(),
+                          _frontierOffsets.end() - 1);
+    for (auto [u, v] : pairs) {
+      _frontiers[fill[u]++] = v;
+    }
+  }
+};
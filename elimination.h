@@ -0,0 +1,245 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "csr_graph.h"
+
+// Elimination (T1/T2 interval reduction) solver for the one-bit equation
+// systems of the LCM analyses. Every equation has the form
+//
+//   x_n = C_n | (F_n ? A : MEET_m f_nm(x_m))
+//
+// over the CFG predecessors m of n (forward problems) or its successors
+// (backward problems). MEET is AND for the greatest fixpoints and OR for the
+// least ones, A is its absorbing value (0 resp. 1), and every edge function
+// is one of the three monotone one-bit functions Zero, One and Id, which are
+// closed under composition and meet.
+//
+// T2 folds a node with a single CFG predecessor into that predecessor by
+// substituting its equation; T1 solves the self-loop this leaves behind a
+// back edge in closed form (Id is neutral in a self-loop, A forces the
+// node). A reducible CFG collapses to its entry in one sweep, and a second
+// sweep in reverse folding order recovers the value of every node, so the
+// cost does not depend on loop nesting depth. solve() returns false, with
+// nothing stored, if the graph is irreducible.
+class EliminationSolver {
+public:
+  enum class Fn : char { Zero, One, Id };
+
+  EliminationSolver(const CSRGraph &g, bool forward, bool meetAnd)
+      : _g(g), _forward(forward), _absorbing(meetAnd ? 0 : 1) {}
+
+  static int apply(Fn fn, int x) {
+    return fn == Fn::Id ? x : fn == Fn::One;
+  }
+
+  // Folding steps plus value recoveries of the last solve().
+  long getSteps() const { return _steps; }
+
+  // node(n) returns {C_n, F_n}. edge(u, v) returns the function of CFG edge
+  // u -> v: how x_u enters the equation of v for forward problems, how x_v
+  // enters the one of u for backward problems. store(n, value) receives the
+  // solution.
+  template <typename Node, typename Edge, typename Store>
+  bool solve(Node node, Edge edge, Store store) {
+    int size = _g.getSize();
+    _steps = 0;
+    _const.assign(size, 0);
+    _forced.assign(size, 0);
+    _alive.assign(size, 1);
+    _predCount.assign(size, 0);
+    _predXor.assign(size, 0);
+    _head.assign(size, -1);
+    _next.clear();
+    _target.clear();
+    _fn.clear();
+    _order.clear();
+    _order.reserve(size);
+    _saved.clear();
+    _savedOffsets.assign(1, 0);
+
+    for (int n = 0; n < size; ++n) {
+      auto [c, forced] = node(n);
+      _const[n] = c;
+      _forced[n] = forced;
+    }
+    for (int u = size - 1; u >= 0; --u) {
+      for (int v : _g.getSuccessors(u)) {
+        Fn fn = edge(u, v);
+        if (u == v) {
+          selfLoop(u, fn);
+          continue;
+        }
+        link(u, v, fn);
+        ++_predCount[v];
+        _predXor[v] ^= u;
+      }
+    }
+
+    std::vector<int> queue;
+    for (int n = 1; n < size; ++n) {
+      if (_predCount[n] == 1) {
+        queue.push_back(n);
+      }
+    }
+    while (!queue.empty()) {
+      int v = queue.back();
+      queue.pop_back();
+      if (_alive[v] && _predCount[v] == 1) {
+        fold(v, _predXor[v], queue);
+      }
+    }
+    if (static_cast<int>(_order.size()) != size - 1 || !_alive[0]) {
+      return false;
+    }
+
+    // Everything is folded into the entry, whose equation is now closed.
+    std::vector<char> value(size, 0);
+    value[0] = _const[0] || (_forced[0] ? _absorbing : !_absorbing);
+    for (int k = size - 2; k >= 0; --k) {
+      auto [v, u, h] = _order[k];
+      if (_forward) {
+        value[v] = apply(h, value[u]);
+      } else {
+        int meet = _forced[v] ? _absorbing : !_absorbing;
+        for (int i = _savedOffsets[k]; i < _savedOffsets[k + 1]; ++i) {
+          if (meet == _absorbing) {
+            break;
+          }
+          meet = apply(_saved[i].second, value[_saved[i].first]);
+        }
+        value[v] = _const[v] || meet;
+      }
+      ++_steps;
+    }
+    for (int n = 0; n < size; ++n) {
+      store(n, value[n]);
+    }
+    return true;
+  }
+
+private:
+  struct Fold {
+    int node;
+    int into;
+    Fn fn; // forward problems: x_node = fn(x_into)
+  };
+
+  const CSRGraph &_g;
+  bool _forward;
+  int _absorbing;
+  long _steps = 0;
+  std::vector<char> _const;
+  std::vector<char> _forced;
+  std::vector<char> _alive;
+  std::vector<int> _predCount;
+  std::vector<int> _predXor;
+  // Current out-edges of every node as linked lists in one pool, so
+  // folding moves edges without allocating.
+  std::vector<int> _head;
+  std::vector<int> _next;
+  std::vector<int> _target;
+  std::vector<Fn> _fn;
+  std::vector<Fold> _order;
+  // Backward problems: the successor list of every folded node, in folding
+  // order, for recovering its value.
+  std::vector<std::pair<int, Fn>> _saved;
+  std::vector<int> _savedOffsets;
+
+  static Fn compose(Fn outer, Fn inner) {
+    return outer == Fn::Id ? inner : outer;
+  }
+
+  Fn meet(Fn a, Fn b) const {
+    Fn absorbing = _absorbing ? Fn::One : Fn::Zero;
+    if (a == absorbing || b == absorbing) {
+      return absorbing;
+    }
+    return a == Fn::Id ? a : b;
+  }
+
+  Fn constant(int value) const { return value ? Fn::One : Fn::Zero; }
+
+  void link(int u, int v, Fn fn) {
+    _next.push_back(_head[u]);
+    _target.push_back(v);
+    _fn.push_back(fn);
+    _head[u] = static_cast<int>(_target.size()) - 1;
+  }
+
+  // T1: the equation of u contains fn(x_u).
+  void selfLoop(int u, Fn fn) {
+    if (fn == constant(_absorbing)) {
+      _forced[u] = 1;
+    }
+  }
+
+  // T2: fold v into its only predecessor u.
+  void fold(int v, int u, std::vector<int> &queue) {
+    int *link = &_head[u];
+    while (_target[*link] != v) {
+      link = &_next[*link];
+    }
+    Fn fuv = _fn[*link];
+    *link = _next[*link];
+
+    // h: how an edge v -> w of v reappears as an edge u -> w.
+    Fn h = Fn::Id;
+    if (_forward) {
+      // x_v = C_v | (F_v ? A : fuv(x_u)) as a function of x_u.
+      h = _const[v] ? Fn::One : _forced[v] ? constant(_absorbing) : fuv;
+      _order.push_back({v, u, h});
+    } else {
+      // u's term fuv(x_v) either expands into v's successor terms or is a
+      // constant; a constant A forces u, anything else drops out.
+      if (fuv != Fn::Id || _const[v] || _forced[v]) {
+        int term = fuv != Fn::Id ? fuv == Fn::One
+                   : _const[v]   ? 1
+                                 : _absorbing;
+        if (term == _absorbing) {
+          _forced[u] = 1;
+        }
+        h = constant(!_absorbing);
+      }
+      _order.push_back({v, u, fuv});
+      for (int e = _head[v]; e >= 0; e = _next[e]) {
+        _saved.emplace_back(_target[e], _fn[e]);
+      }
+      _savedOffsets.push_back(_saved.size());
+    }
+    ++_steps;
+
+    for (int e = _head[v], next; e >= 0; e = next) {
+      next = _next[e];
+      int w = _target[e];
+      Fn fn = _forward ? compose(_fn[e], h) : h == Fn::Id ? _fn[e] : h;
+      if (w == u) {
+        selfLoop(u, fn);
+        --_predCount[u];
+        _predXor[u] ^= v;
+      } else {
+        int i = _head[u];
+        while (i >= 0 && _target[i] != w) {
+          i = _next[i];
+        }
+        if (i >= 0) {
+          _fn[i] = meet(_fn[i], fn);
+          --_predCount[w];
+          _predXor[w] ^= v;
+        } else {
+          // Reuse the record: move it to the front of u's list.
+          _fn[e] = fn;
+          _next[e] = _head[u];
+          _head[u] = e;
+          _predXor[w] ^= v ^ u;
+        }
+      }
+      if (_predCount[w] == 1 && w != 0) {
+        queue.push_back(w);
+      }
+    }
+    _alive[v] = 0;
+    _head[v] = -1;
+  }
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "flow_graph.h"
+
+// Dynamic evaluation counts of a + b on a solved FlowGraph: how often one
+// run of the program evaluates it as written, after BCM (an insertion at
+// every down-safe earliest node) and after LCM (an insertion at every
+// optimal computation point, plus the isolated computations left in
+// place). Every other original use reads h. Blocks given as instruction
+// lists also re-evaluate a + b once after each kill that a later use
+// follows, whatever the placement. BCM and LCM are computationally optimal,
+// so on a t-refined graph (see FlowGraph::makeTRefined) both counts agree
+// and never exceed the original; elsewhere a node-level insertion below a
+// join can repeat a value one predecessor already computed.
+//
+// Control flow follows edge weights: branch probabilities or an execution
+// count profile, normalized over the out-edges of each block (unweighted
+// edges count 1). expected() solves the Markov chain for the expected
+// number of executions of every block; monteCarlo() walks random paths as
+// a cross-check.
+class EvaluationSimulator {
+public:
+  struct Counts {
+    double original = 0;
+    double bcm = 0;
+    double lcm = 0;
+  };
+
+  explicit EvaluationSimulator(const FlowGraph &g)
+      : _g(g), _size(g.getSize()), _offsets(_size + 1, 0) {
+    for (int u = 0; u < _size; ++u) {
+      _offsets[u + 1] = _offsets[u] + g.getSuccessors(u).size();
+    }
+    _weights.assign(_offsets[_size], 1.0);
+  }
+
+  // Weight of edge u -> v. If the edge has been split, the weight goes to
+  // the edge from u to the synthetic node on it.
+  void setEdgeWeight(int u, int v, double weight) {
+    auto succs = _g.getSuccessors(u);
+    for (std::size_t k = 0; k < succs.size(); ++k) {
+      int s = succs[k];
+      if (s == v || (_g.isSynthetic(s) &&
+                     _g.getSplitEdge(s) == std::pair<int, int>(u, v))) {
+        _weights[_offsets[u] + k] = weight;
+        return;
+      }
+    }
+  }
+
+  // Expected executions of every block per run, by Gauss-Seidel sweeps in
+  // reverse postorder until no block changes by more than tolerance
+  // (relative) or maxSweeps is reached.
+  std::vector<double> getFrequencies(double tolerance = 1e-12,
+                                     int maxSweeps = 100000) const {
+    std::vector<int> order(_size);
+    auto rank = _g.getRPORank();
+    for (int u = 0; u < _size; ++u) {
+      order[rank[u]] = u;
+    }
+    std::vector<double> inflow(_size, 0.0), freq(_size, 0.0);
+    for (int sweep = 0; sweep < maxSweeps; ++sweep) {
+      double delta = 0;
+      for (int u : order) {
+        double value = u == 0 ? 1.0 : inflow[u];
+        if (value != freq[u]) {
+          delta = std::max(delta,
+                           std::abs(value - freq[u]) / std::max(value, 1.0));
+          // Push the change along the out-edges right away.
+          auto succs = _g.getSuccessors(u);
+          double total = outWeight(u);
+          for (std::size_t k = 0; k < succs.size(); ++k) {
+            inflow[succs[k]] +=
+                (value - freq[u]) * _weights[_offsets[u] + k] / total;
+          }
+          freq[u] = value;
+        }
+      }
+      if (delta <= tolerance) {
+        break;
+      }
+    }
+    return freq;
+  }
+
+  // Expected traversals per run of edge u -> getSuccessors(u)[k], given
+  // the block frequencies of getFrequencies().
+  double getEdgeFrequency(const std::vector<double> &freq, int u,
+                          std::size_t k) const {
+    return freq[u] * _weights[_offsets[u] + k] / outWeight(u);
+  }
+
+  Counts expected() const {
+    std::vector<double> freq = getFrequencies();
+    Counts res;
+    for (int u = 0; u < _size; ++u) {
+      Counts block = evaluations(u);
+      res.original += freq[u] * block.original;
+      res.bcm += freq[u] * block.bcm;
+      res.lcm += freq[u] * block.lcm;
+    }
+    return res;
+  }
+
+  // Mean counts over `walks` random paths from the entry. A walk that has
+  // not reached the exit after maxSteps blocks is cut off there.
+  Counts monteCarlo(long walks, std::uint64_t seed = 1,
+                    long maxSteps = 1000000) const {
+    std::vector<Counts> block(_size);
+    for (int u = 0; u < _size; ++u) {
+      block[u] = evaluations(u);
+    }
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    Counts sum;
+    for (long w = 0; w < walks; ++w) {
+      int u = 0;
+      for (long step = 0; step < maxSteps; ++step) {
+        sum.original += block[u].original;
+        sum.bcm += block[u].bcm;
+        sum.lcm += block[u].lcm;
+        auto succs = _g.getSuccessors(u);
+        if (succs.empty()) {
+          break;
+        }
+        double pick = coin(rng) * outWeight(u);
+        std::size_t k = 0;
+        while (k + 1 < succs.size() && pick >= _weights[_offsets[u] + k]) {
+          pick -= _weights[_offsets[u] + k];
+          ++k;
+        }
+        u = succs[k];
+      }
+    }
+    if (walks > 0) {
+      sum.original /= walks;
+      sum.bcm /= walks;
+      sum.lcm /= walks;
+    }
+    return sum;
+  }
+
+  // Uses in block u that follow a kill there: every kill that a use
+  // follows before the next kill costs one evaluation of a + b under any
+  // placement.
+  static int getLocalRecomputations(const FlowGraph &g, int u) {
+    int count = 0;
+    bool killed = false;
+    for (FlowGraph::Instr instr : g.getInstructions(u)) {
+      if (FlowGraph::evaluates(instr)) {
+        count += killed;
+        killed = false;
+      } else if (instr == FlowGraph::Instr::Kill) {
+        killed = true;
+      }
+    }
+    return count;
+  }
+
+private:
+  const FlowGraph &_g;
+  int _size;
+  std::vector<std::size_t> _offsets;
+  std::vector<double> _weights;
+
+  double outWeight(int u) const {
+    double total = 0;
+    for (std::size_t e = _offsets[u]; e < _offsets[u + 1]; ++e) {
+      total += _weights[e];
+    }
+    return total;
+  }
+
+  // Evaluations of a + b by one execution of block u.
+  Counts evaluations(int u) const {
+    Counts res;
+    if (u == 0 || u == _size - 1) {
+      return res;
+    }
+    const std::vector<FlowGraph::Instr> &code = _g.getInstructions(u);
+    res.original = code.empty() ? _g.isUsed(u)
+                                : std::count_if(code.begin(), code.end(),
+                                                FlowGraph::evaluates);
+    int afterKill = getLocalRecomputations(_g, u);
+    int latest = _g.getLatest()[u];
+    res.bcm = (_g.getDownSafety()[u] && _g.getEarliestness()[u]) + afterKill;
+    res.lcm = latest + afterKill;
+    return res;
+  }
+};
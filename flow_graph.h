@@ -0,0 +1,1578 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "csr_graph.h"
+#include "elimination.h"
+#include "pass_stats.h"
+#include "predicate_store.h"
+#include "result_writer.h"
+#include "trace.h"
+
+class FlowGraph : public CSRGraph {
+public:
+  // Instructions of a basic block, as far as a + b is concerned. Assign
+  // and UseX are the assignment that partial dead code elimination sinks
+  // (see PartialDeadCode) and the reads of its target x; for LCM an Assign
+  // is just another use of a + b.
+  enum class Instr {
+    Use,    // ... := a + b
+    Kill,   // a := c
+    Other,  // anything else
+    Assign, // x := a + b
+    UseX    // ... := x
+  };
+
+  // Whether instr evaluates a + b.
+  static bool evaluates(Instr instr) {
+    return instr == Instr::Use || instr == Instr::Assign;
+  }
+
+  FlowGraph(int size)
+      : CSRGraph(size + 2), _store(_size), _code(_size) {
+    bindColumns();
+  }
+
+  // A node with both flags set uses a + b before killing it, so it is only
+  // available at the exit of nodes that use it without killing.
+  void setUsed(int u, bool used = true) {
+    _used[u] = used;
+    _comp[u] = _used[u] && !_killed[u];
+    logNode(u);
+  }
+
+  void setKilled(int u, bool killed = true) {
+    _kills[u] = killed;
+    updateKilled(u);
+    logNode(u);
+  }
+
+  // Lazy Strength Reduction (Knoop, Ruething, Steffen) reads the candidate
+  // as a * b and lets an injured node update a by a constant (a := a + c)
+  // instead of killing it: h then stays valid through the node if an update
+  // h := h + c * b follows the injury. Outside strength reduction mode an
+  // injury is an ordinary kill. The kill flag of the node is kept apart, so
+  // a node that is both killed and injured stays killed in either mode.
+  void setInjured(int u, bool injured = true) {
+    _injured[u] = injured;
+    updateKilled(u);
+    logNode(u);
+  }
+
+  // Treat injuries as transparent in all analyses (the caller then runs
+  // StrengthReduction after the pipeline) or as kills again.
+  void setStrengthReduction(bool enabled) {
+    _strengthReduction = enabled;
+    for (int u = 0; u < _size; ++u) {
+      if (_injured[u]) {
+        updateKilled(u);
+        logNode(u);
+      }
+    }
+  }
+
+  // Edges can also be added or removed once the graph is solved; see
+  // Incremental for bringing the solution up to date afterwards.
+  void addEdge(int u, int v) {
+    CSRGraph::addEdge(u, v);
+    logEdge(u, v);
+  }
+
+  void removeEdge(int u, int v) {
+    CSRGraph::removeEdge(u, v);
+    logEdge(u, v);
+  }
+
+  // Append an instruction to basic block u. Blocks with instructions get
+  // their local predicates from computeLocalPredicates() instead of the
+  // setUsed/setKilled flags.
+  void addInstruction(int u, Instr instr) {
+    _code[u].push_back(instr);
+    _dirtyBlocks.push_back(u);
+    logNode(u);
+  }
+
+  bool isUsed(int u) const { return _used[u]; }
+
+  bool isKilled(int u) const { return _killed[u]; }
+
+  bool isInjured(int u) const { return _injured[u]; }
+
+  // a + b is computed in u and still valid at its exit (COMP).
+  bool isComputed(int u) const { return _comp[u]; }
+
+  const std::vector<Instr> &getInstructions(int u) const { return _code[u]; }
+
+  // Local pre-pass over the instruction lists: ANTLOC (a use before any
+  // kill) goes to _used, !TRANSP (any kill) to _killed and COMP (a use
+  // after the last kill) to _comp. The global solvers then only look at
+  // these block-level predicates.
+  void computeLocalPredicates() {
+    for (int u : _dirtyBlocks) {
+      int antloc = 0, transp = 1, comp = 0;
+      for (Instr instr : _code[u]) {
+        if (evaluates(instr)) {
+          antloc = antloc || transp;
+          comp = 1;
+        } else if (instr == Instr::Kill) {
+          transp = 0;
+          comp = 0;
+        }
+      }
+      _used[u] = antloc;
+      _kills[u] = !transp;
+      _killed[u] = !transp || (_injured[u] && !_strengthReduction);
+      _comp[u] = comp;
+    }
+    _dirtyBlocks.clear();
+  }
+
+  // Local pre-pass of partial dead code elimination, over the instruction
+  // lists (flag-only blocks count as their kill, if any). An injury
+  // changes a as well, so it blocks sinking like a kill.
+  void computeAssignPredicates() {
+    _assignLocal.assign(_size, 0);
+    for (int u = 0; u < _size; ++u) {
+      std::uint8_t local = 0;
+      int first = -1, last = -1;
+      bool assigned = false;
+      if (_code[u].empty()) {
+        if (_killed[u] || _injured[u]) {
+          local = kAssignOpaque | kAssignBlocked;
+        }
+      }
+      for (Instr instr : _code[u]) {
+        if (instr == Instr::Other || instr == Instr::Use) {
+          continue;
+        }
+        if (first < 0) {
+          first = static_cast<int>(instr);
+        }
+        last = static_cast<int>(instr);
+        if (instr == Instr::UseX && !assigned) {
+          local |= kAssignReadsX;
+        }
+        assigned = assigned || instr == Instr::Assign;
+      }
+      if (first >= 0) {
+        local |= kAssignOpaque;
+      }
+      if (first >= 0 && first != static_cast<int>(Instr::Assign)) {
+        local |= kAssignBlocked;
+      }
+      if (last == static_cast<int>(Instr::Assign)) {
+        local |= kAssignLeaves;
+      }
+      if (assigned) {
+        local |= kAssignWritesX;
+      }
+      _assignLocal[u] = local;
+    }
+  }
+
+  // Split all critical edges in place (see CSRGraph::splitCriticalEdgesCSR)
+  // and grow the per-node arrays to match. Returns the number of new nodes.
+  int splitCriticalEdges() {
+    int count = splitCriticalEdgesCSR();
+    growAllNodes(count);
+    return count;
+  }
+
+  // Make the graph t-refined: split critical edges and the join edges
+  // leaving the entry or killing nodes. In strength reduction mode injured
+  // nodes count as killing too, so that an insertion can always be delayed
+  // past the injury instead of needing an update; otherwise they are
+  // killing anyway. Returns the number of new nodes.
+  int makeTRefined() {
+    int count = makeTRefinedCSR([this](int u) {
+      return _killed[u] == 1 || (_strengthReduction && _injured[u] == 1);
+    });
+    growAllNodes(count);
+    return count;
+  }
+
+  PredicateView getDownSafety() const { return _downsafety; }
+
+  PredicateView getUpSafety() const { return _upsafety; }
+
+  PredicateView getEarliestness() const { return _earliestness; }
+
+  PredicateView getDelay() const { return _delay; }
+
+  PredicateView getLatest() const { return _latest; }
+
+  PredicateView getIsolated() const { return _isolated; }
+
+  PredicateView getUpdate() const { return _update; }
+
+  void printVector(PredicateView vec) const {
+    for (int i = 1; i < _size - 1; ++i) {
+      if (vec[i] == 1) {
+        std::cout << i << ", ";
+      }
+    }
+    std::cout << "\n";
+  }
+
+  void getPlacementBCM(std::ostream &outs = std::cout) {
+    PassRecorder recorder(_passStats, "PlacementBCM");
+    recorder.stats().visits = _size - 2;
+    outs << "[Get Placement of BCM]: ";
+    for (int i = 1; i < _size - 1; ++i) {
+      if ((_downsafety[i] == 1) && (_earliestness[i] == 1)) {
+        printNode(i, outs);
+      }
+    }
+    outs << "\n";
+  }
+
+  void getPlacementLCM(std::ostream &outs = std::cout) {
+    PassRecorder recorder(_passStats, "PlacementLCM");
+    recorder.stats().visits = 3 * (_size - 2);
+    outs << "[Get Placement of LCM]:\n";
+    outs << "[Optimal Computation Points]: ";
+    for (int i = 1; i < _size - 1; ++i) {
+      if (isOptimalPoint(i)) {
+        printNode(i, outs);
+      }
+    }
+    outs << "\n";
+
+    outs << "[Isolated Computation]: ";
+    for (int i = 1; i < _size - 1; ++i) {
+      if (isIsolatedComputation(i)) {
+        printNode(i, outs);
+      }
+    }
+    outs << "\n";
+
+    outs << "[Redundant Occurrence]: ";
+    for (int i = 1; i < _size - 1; ++i) {
+      if (isRedundant(i)) {
+        printNode(i, outs);
+      }
+    }
+    outs << "\n";
+  }
+
+  // The strength reduction part of the placement, after StrengthReduction:
+  // the updates, and the uses an update serves. Without strength reduction
+  // the injury before each of those would kill a + b and force another
+  // multiplication on the way to the use; now it costs an addition.
+  void getPlacementLSR(std::ostream &outs = std::cout) {
+    PassRecorder recorder(_passStats, "PlacementLSR");
+    // updated[u]: on some path to the exit of u, h was last set by an
+    // update rather than computed.
+    std::vector<char> updated(_size, 0);
+    Worklist worklist{getRPORank(), getWorklistOrder()};
+    for (int i = 1; i < _size - 1; ++i) {
+      if (_update[i]) {
+        worklist.push(i);
+      }
+    }
+    while (!worklist.empty()) {
+      int u = worklist.pop();
+      int reached = 0;
+      for (auto tmp_u : getPrecessors(u)) {
+        reached = reached || updated[tmp_u];
+      }
+      int value =
+          _update[u] || (reached && !isOptimalPoint(u) && !_killed[u]);
+      if (value != updated[u]) {
+        updated[u] = value;
+        for (auto tmp_v : getSuccessors(u)) {
+          worklist.push(tmp_v);
+        }
+      }
+    }
+    recorder.stats().visits = worklist.getVisits();
+
+    outs << "[Get Placement of LSR]:\n";
+    outs << "[Update h := h + c * b after]: ";
+    for (int i = 1; i < _size - 1; ++i) {
+      if (_update[i]) {
+        printNode(i, outs);
+      }
+    }
+    outs << "\n";
+
+    outs << "[Multiplications Turned into Additions]: ";
+    for (int i = 1; i < _size - 1; ++i) {
+      int reached = 0;
+      for (auto tmp_u : getPrecessors(i)) {
+        reached = reached || updated[tmp_u];
+      }
+      if (_used[i] && !_latest[i] && reached) {
+        printNode(i, outs);
+      }
+    }
+    outs << "\n";
+  }
+
+  // LCM placement at instruction positions: BBu#i is instruction i of block
+  // u, and insertions go in front of #0. A block that kills a + b ends the
+  // lifetime of a value inserted at its entry, so such an insertion only
+  // feeds the block itself and is reported as an isolated computation. The
+  // last use after a kill is computed into h whenever h is live at the exit.
+  void getPlacementInstrLCM(std::ostream &outs = std::cout) {
+    PassRecorder recorder(_passStats, "PlacementInstrLCM");
+    recorder.stats().visits = _size - 2;
+    std::vector<std::pair<int, int>> inserts, saves, isolated, redundant;
+    std::vector<Instr> flags;
+    for (int u = 1; u < _size - 1; ++u) {
+      const std::vector<Instr> *code = &_code[u];
+      if (code->empty()) {
+        // Flag-only block: a use (if any) happens before the kill.
+        flags.clear();
+        if (_used[u]) {
+          flags.push_back(Instr::Use);
+        }
+        if (_killed[u]) {
+          flags.push_back(Instr::Kill);
+        }
+        code = &flags;
+      }
+
+      int avail = 0;
+      if (_latest[u] && !_isolated[u] && !_killed[u]) {
+        inserts.emplace_back(u, 0);
+        avail = 1;
+      } else if (_used[u] && !_latest[u]) {
+        avail = 1;
+      }
+
+      // Walk backwards once to know, for every use, whether another use
+      // follows before the next kill and whether any kill follows at all.
+      int n = static_cast<int>(code->size());
+      std::vector<char> useAhead(n), killAhead(n);
+      int use = 0, kill = 0;
+      for (int i = n - 1; i >= 0; --i) {
+        useAhead[i] = use;
+        killAhead[i] = kill;
+        if (evaluates((*code)[i])) {
+          use = 1;
+        } else if ((*code)[i] == Instr::Kill) {
+          use = 0;
+          kill = 1;
+        }
+      }
+
+      for (int i = 0; i < n; ++i) {
+        if ((*code)[i] == Instr::Kill) {
+          avail = 0;
+        } else if (evaluates((*code)[i])) {
+          if (avail) {
+            redundant.emplace_back(u, i);
+          } else if (useAhead[i] || (!killAhead[i] && !_isolated[u])) {
+            saves.emplace_back(u, i);
+            avail = 1;
+          } else {
+            isolated.emplace_back(u, i);
+          }
+        }
+      }
+    }
+
+    auto print = [&](const char *title,
+                     const std::vector<std::pair<int, int>> &points) {
+      outs << title;
+      for (auto [u, i] : points) {
+        outs << "BB" << u;
+        if (isSynthetic(u)) {
+          outs << "(" << getSplitEdge(u).first << "->"
+               << getSplitEdge(u).second << ")";
+        }
+        outs << "#" << i << ", ";
+      }
+      outs << "\n";
+    };
+    outs << "[Get Placement of LCM at Instructions]:\n";
+    print("[Insert h := a + b before]: ", inserts);
+    print("[Compute into h := a + b]: ", saves);
+    print("[Isolated Computation]: ", isolated);
+    print("[Redundant Occurrence]: ", redundant);
+  }
+
+  void drawBCM(std::string Filepath, int isPlaced) {
+    const char *header = "\tnode[shape=box;];\n";
+    drawDot("DrawBCM", Filepath, header, [&](BufferedWriter &outs, int i) {
+      int isSafety = _downsafety[i], isEarliest = _earliestness[i];
+      if (isPlaced && isSafety && isEarliest) {
+        outs << "h := a + b;\\n";
+      }
+      drawUse(outs, i, isPlaced);
+      drawKill(outs, i);
+      outs << "\"; xlabel=\"BB" << i << ":\";";
+      if (isPlaced && isSafety) {
+        outs << " color=Turquoise;";
+      }
+      if (isPlaced && isEarliest) {
+        outs << " style=filled;";
+      }
+    });
+  }
+
+  void drawALCM(std::string Filepath, int isPlaced) {
+    const char *header = "\tnode[shape=box;];\n";
+    drawDot("DrawALCM", Filepath, header, [&](BufferedWriter &outs, int i) {
+      int isDelay = _delay[i], isLatest = _latest[i];
+      if (isPlaced && isLatest) {
+        outs << "h := a + b;\\n";
+      }
+      drawUse(outs, i, isPlaced);
+      drawKill(outs, i);
+      outs << "\"; xlabel=\"BB" << i << ":\";";
+      if (isPlaced && isDelay) {
+        outs << " style=filled;";
+      }
+      if (isPlaced && isLatest) {
+        outs << " color=yellow;";
+      }
+    });
+  }
+
+  void drawLCM(std::string Filepath) {
+    const char *header = "\tnode[shape=box; color=black;];\n";
+    drawDot("DrawLCM", Filepath, header, [&](BufferedWriter &outs, int i) {
+      int isOCP = isOptimalPoint(i), isIC = isIsolatedComputation(i);
+      int isRO = isRedundant(i);
+      const char *expr = _strengthReduction ? "a * b" : "a + b";
+      if (isOCP) {
+        outs << "h := " << expr << ";\\n";
+      } else if (isIC) {
+        outs << "... := " << expr << ";\\n";
+      }
+      if (isRO) {
+        outs << "... := h;\\n";
+      }
+      if (_injured[i]) {
+        outs << "a := a + c;\\n";
+      }
+      if (_kills[i]) {
+        outs << "a := c;\\n";
+      }
+      if (_update[i]) {
+        outs << "h := h + c * b;\\n";
+      }
+      outs << "\"; xlabel=\"BB" << i << ":\";";
+
+      if (isOCP && !isRO) {
+        outs << " fillcolor=yellow; style=filled;";
+      } else if (isIC) {
+        outs << " fillcolor=pink; style=filled;";
+      }
+      if (isRO) {
+        if (!isOCP) {
+          outs << " fillcolor=darkseagreen3; style=filled;";
+        } else {
+          outs << " fillcolor=\"yellow:darkseagreen3\"; style=filled;";
+        }
+      }
+    });
+  }
+
+  // The instruction lists after partial dead code elimination; blocks that
+  // assign x are yellow.
+  void drawPDCE(std::string Filepath) {
+    const char *header = "\tnode[shape=box; color=black;];\n";
+    drawDot("DrawPDCE", Filepath, header, [&](BufferedWriter &outs, int i) {
+      bool assigns = false;
+      if (_code[i].empty()) {
+        drawUse(outs, i, 0);
+        drawKill(outs, i);
+      }
+      for (Instr instr : _code[i]) {
+        switch (instr) {
+        case Instr::Use:
+          outs << "... := a + b;\\n";
+          break;
+        case Instr::Kill:
+          outs << "a := c;\\n";
+          break;
+        case Instr::Assign:
+          outs << "x := a + b;\\n";
+          assigns = true;
+          break;
+        case Instr::UseX:
+          outs << "... := x;\\n";
+          break;
+        default:
+          outs << "...;\\n";
+        }
+      }
+      outs << "\"; xlabel=\"BB" << i << ":\";";
+      if (assigns) {
+        outs << " fillcolor=yellow; style=filled;";
+      }
+    });
+  }
+
+  // Compact result format for tools without Graphviz: NDJSON with one
+  // object per node (entry and exit included) carrying its successors,
+  // local predicates, analysis results and LCM classification, e.g.
+  //   {"node":3,"succs":[4,7],"used":1,"killed":0,"dsafe":1,"usafe":0,
+  //    "earliest":0,"delay":1,"latest":1,"isolated":0,"ocp":1,"ic":0,"ro":1}
+  // Synthetic nodes also carry "split":[u,v], the edge they were put on.
+  void writeResults(const std::string &Filepath) {
+    finalize();
+    PassRecorder recorder(_passStats, "WriteResults");
+    recorder.stats().visits = _size;
+    BufferedWriter outs(Filepath);
+    for (int i = 0; i < _size; ++i) {
+      outs << "{\"node\":" << i << ",\"succs\":[";
+      const char *sep = "";
+      for (auto j : getSuccessors(i)) {
+        outs << sep << j;
+        sep = ",";
+      }
+      outs << "]";
+      if (isSynthetic(i)) {
+        outs << ",\"split\":[" << getSplitEdge(i).first << ","
+             << getSplitEdge(i).second << "]";
+      }
+      outs << ",\"used\":" << _used[i] << ",\"killed\":" << _killed[i]
+           << ",\"dsafe\":" << _downsafety[i] << ",\"usafe\":" << _upsafety[i]
+           << ",\"earliest\":" << _earliestness[i]
+           << ",\"delay\":" << _delay[i] << ",\"latest\":" << _latest[i]
+           << ",\"isolated\":" << _isolated[i]
+           << ",\"ocp\":" << isOptimalPoint(i)
+           << ",\"ic\":" << isIsolatedComputation(i)
+           << ",\"ro\":" << isRedundant(i) << "}\n";
+    }
+  }
+
+private:
+  using Fn = EliminationSolver::Fn;
+
+  // The Dataflow problems of the pipeline.
+
+  // x_u = used(u) | (!killed(u) & AND of the successors); 0 at the exit.
+  struct DownSafetyProblem {
+    static constexpr bool kForward = false;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "D-Safe";
+    static constexpr const char *kPass = "DownSafety";
+
+    static std::pair<int, int> node(const FlowGraph &g, int u) {
+      if (u == g._size - 1) {
+        return {0, 1};
+      }
+      return {g._used[u], g._killed[u]};
+    }
+
+    static Fn edge(const FlowGraph &, int, int) { return Fn::Id; }
+  };
+
+  // Up-safety (availability): a + b has been computed on every path from
+  // the entry to the node, with no kill after the last computation.
+  // x_v = AND over the predecessors u of (comp(u) | (x_u & !killed(u))). The
+  // entry block is no placement point, so nothing is up-safe below it.
+  struct UpSafetyProblem {
+    static constexpr bool kForward = true;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "U-Safe";
+    static constexpr const char *kPass = "UpSafety";
+
+    static std::pair<int, int> node(const FlowGraph &, int v) {
+      return {0, v == 0};
+    }
+
+    static Fn edge(const FlowGraph &g, int u, int) {
+      if (g._comp[u]) {
+        return Fn::One;
+      }
+      return u == 0 || g._killed[u] ? Fn::Zero : Fn::Id;
+    }
+  };
+
+  // x_v = (dsafe(v) & earliest(v)) | AND over the predecessors u of
+  // (!used(u) & x_u); 0 at the entry.
+  struct DelayProblem {
+    static constexpr bool kForward = true;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "Delay";
+    static constexpr const char *kPass = "Delay";
+
+    static std::pair<int, int> node(const FlowGraph &g, int v) {
+      if (v == 0) {
+        return {0, 1};
+      }
+      return {g._downsafety[v] && g._earliestness[v], 0};
+    }
+
+    static Fn edge(const FlowGraph &g, int u, int) {
+      return g._used[u] ? Fn::Zero : Fn::Id;
+    }
+  };
+
+  // x_u = AND over the successors v of (latest(v) | (!used(v) &
+  // (killed(v) | x_v))). used(v) is ANTLOC, so a v that kills a + b before
+  // any use ends the value h carries in: the uses after the kill read what
+  // v recomputes, not h. It should be True at the exit node to have the
+  // greatest solution!
+  struct IsolatedProblem {
+    static constexpr bool kForward = false;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "Isolated";
+    static constexpr const char *kPass = "Isolated";
+
+    static std::pair<int, int> node(const FlowGraph &g, int u) {
+      return {u == g._size - 1, 0};
+    }
+
+    static Fn edge(const FlowGraph &g, int, int v) {
+      if (g._latest[v]) {
+        return Fn::One;
+      }
+      if (g._used[v]) {
+        return Fn::Zero;
+      }
+      return g._killed[v] ? Fn::One : Fn::Id;
+    }
+  };
+
+  // Liveness of h after LCM: x_u = (used(u) & !latest(u)) | OR over the
+  // successors v of x_v, unless u defines h (an optimal computation point)
+  // or kills a + b. The uses of non-latest nodes are the redundant ones
+  // that read h; a latest node computes a + b itself.
+  struct LiveProblem {
+    static constexpr bool kForward = false;
+    static constexpr bool kMeetAnd = false;
+    static constexpr const char *kName = "Live";
+    static constexpr const char *kPass = "Live";
+
+    static std::pair<int, int> node(const FlowGraph &g, int u) {
+      return {g._used[u] && !g._latest[u], 0};
+    }
+
+    static Fn edge(const FlowGraph &g, int u, int) {
+      return g.isOptimalPoint(u) || g._killed[u] ? Fn::Zero : Fn::Id;
+    }
+  };
+
+  // Partial dead code elimination, the dual of LCM: the assignment
+  // x := a + b is sunk instead of hoisted. Sinkable is the counterpart of
+  // Delay: x_v = leaves(v) | (!opaque(v) & AND of the predecessors); 0 at
+  // the entry. leaves(v): an assignment in v has nothing after it that
+  // reads x or changes a; opaque(v): v reads x, assigns it or changes a.
+  struct SinkProblem {
+    static constexpr bool kForward = true;
+    static constexpr bool kMeetAnd = true;
+    static constexpr const char *kName = "Sinkable";
+    static constexpr const char *kPass = "Sinkable";
+
+    static std::pair<int, int> node(const FlowGraph &g, int v) {
+      if (v == 0) {
+        return {0, 1};
+      }
+      std::uint8_t local = g._assignLocal[v];
+      return {(local & kAssignLeaves) != 0, (local & kAssignOpaque) != 0};
+    }
+
+    static Fn edge(const FlowGraph &, int, int) { return Fn::Id; }
+  };
+
+  // Liveness of x, the counterpart of Isolated: x_u = readsX(u) | OR over
+  // the successors v of x_v unless u assigns x. x is dead at the exit.
+  struct LiveXProblem {
+    static constexpr bool kForward = false;
+    static constexpr bool kMeetAnd = false;
+    static constexpr const char *kName = "X-Live";
+    static constexpr const char *kPass = "XLive";
+
+    static std::pair<int, int> node(const FlowGraph &g, int u) {
+      return {(g._assignLocal[u] & kAssignReadsX) != 0, 0};
+    }
+
+    static Fn edge(const FlowGraph &g, int u, int) {
+      return g._assignLocal[u] & kAssignWritesX ? Fn::Zero : Fn::Id;
+    }
+  };
+
+public:
+  // One fixpoint solver for all dataflow problems of the pipeline. The
+  // Problem policy gives the direction (kForward), the meet (kMeetAnd: AND
+  // and greatest fixpoint, else OR and least fixpoint), the trace name and
+  // the equations in the form EliminationSolver uses:
+  //
+  //   x_n = C | (F ? A : MEET over the dependencies m of edge(m)(x_m))
+  //
+  // where node(g, n) returns {C, F} and edge(g, u, v) the function of CFG
+  // edge u -> v. The boundary node (entry or exit) is fixed by node() alone.
+  // All of it is static, so each instantiation compiles to a loop as tight
+  // as a hand-written solver, and every engine works for every problem.
+  template <typename Problem, typename Trace> class Dataflow {
+  public:
+    Dataflow(FlowGraph &g, PredicateColumn result, Trace trace)
+        : _g(g), _size(g._size), _result(result), _trace(trace) {}
+
+    // Number of nodes popped from the worklist by the last compute(), or
+    // elimination steps with the Elimination engine. The other counters of
+    // the run are in the graph's pass stats under Problem::kPass.
+    long getVisitCount() const { return _visits; }
+
+    void compute() {
+      PassRecorder recorder(_g._passStats, Problem::kPass);
+      _g.finalize();
+      _g.computeLocalPredicates();
+
+      if (_g.eliminate(
+              Problem::kForward, Problem::kMeetAnd, _result, recorder.stats(),
+              [this](int n) { return Problem::node(_g, n); },
+              [this](int u, int v) { return Problem::edge(_g, u, v); })) {
+        _visits = recorder.stats().visits;
+        return;
+      }
+
+      for (int i = 0; i < _size; ++i) {
+        _result[i] = kTop;
+      }
+      _result[kBoundary(_size)] = evaluate(kBoundary(_size));
+
+      Worklist worklist{
+          Problem::kForward ? _g.getRPORank() : _g.getPostOrderRank(),
+          _g.getWorklistOrder()};
+      int first = Problem::kForward ? 1 : 0;
+      _changes = 0;
+      _g.runEngine(worklist, Problem::kForward, first, first + _size - 2,
+                   [this](Worklist &w, int scc) { solve(w, nullptr, scc); });
+      _visits = worklist.getVisits();
+      record(recorder.stats(), worklist);
+      _trace.flush();
+    }
+
+    // Re-solve after the equations of the seed nodes changed, starting from
+    // the previous solution. Returns the nodes whose value changed.
+    std::vector<int> recompute(const std::vector<int> &seeds) {
+      PassRecorder recorder(_g._passStats,
+                            std::string(Problem::kPass) + ".recompute");
+      _g.computeLocalPredicates();
+      Worklist worklist{
+          Problem::kForward ? _g.getRPORank() : _g.getPostOrderRank(),
+          _g.getWorklistOrder()};
+      std::vector<std::pair<int, int>> old;
+      _changes = 0;
+      _g.resetRegion(_result, kTop, seeds, kBoundary(_size), old,
+                     [this](int u) { return dependents(u); });
+      for (auto [u, value] : old) {
+        worklist.push(u);
+      }
+      solve(worklist, &old);
+      _visits = worklist.getVisits();
+      record(recorder.stats(), worklist);
+      _trace.flush();
+      return _g.collectChanged(_result, old);
+    }
+
+  protected:
+    FlowGraph &_g;
+    int _size;
+    PredicateColumn _result;
+    long _visits = 0;
+    Trace _trace;
+
+  private:
+    static constexpr int kTop = Problem::kMeetAnd ? 1 : 0;
+
+    long _changes = 0;
+
+    void record(PassStats &stats, const Worklist &worklist) const {
+      stats.visits = worklist.getVisits();
+      stats.pushes = worklist.getPushes();
+      stats.changes = _changes;
+      stats.iterations = worklist.getSweeps();
+    }
+
+    static constexpr int kBoundary(int size) {
+      return Problem::kForward ? 0 : size - 1;
+    }
+
+    std::span<const int> dependencies(int n) const {
+      return Problem::kForward ? _g.getPrecessors(n) : _g.getSuccessors(n);
+    }
+
+    std::span<const int> dependents(int n) const {
+      return Problem::kForward ? _g.getSuccessors(n) : _g.getPrecessors(n);
+    }
+
+    int evaluate(int n) const {
+      auto [c, forced] = Problem::node(_g, n);
+      if (c || forced) {
+        return c || !Problem::kMeetAnd;
+      }
+      for (int m : dependencies(n)) {
+        Fn fn = Problem::kForward ? Problem::edge(_g, m, n)
+                                  : Problem::edge(_g, n, m);
+        if (EliminationSolver::apply(fn, _result[m]) != kTop) {
+          return !kTop;
+        }
+      }
+      return kTop;
+    }
+
+    void solve(Worklist &worklist, std::vector<std::pair<int, int>> *old,
+               int scc = -1) {
+      while (!worklist.empty()) {
+        int n = worklist.pop();
+        int value = evaluate(n);
+        if (value != _result[n]) {
+          ++_changes;
+          _trace.update(Problem::kName, n, value);
+          _g.remember(_result, n, old);
+          _result[n] = value;
+          for (int m : dependents(n)) {
+            if (_g.inScope(m, scc)) {
+              worklist.push(m);
+              _trace.push(m);
+            }
+          }
+        }
+      }
+    }
+  };
+
+  template <typename Trace = Tracer<true>>
+  class DownSafety : public Dataflow<DownSafetyProblem, Trace> {
+  public:
+    DownSafety(FlowGraph &g, Trace trace = Trace())
+        : DownSafety(g, trace, g._downsafety) {}
+
+    // Solve into result instead of the graph's DownSafety column.
+    DownSafety(FlowGraph &g, Trace trace, PredicateColumn result)
+        : Dataflow<DownSafetyProblem, Trace>(g, result, trace) {}
+  };
+
+  template <typename Trace = Tracer<true>>
+  class UpSafety : public Dataflow<UpSafetyProblem, Trace> {
+  public:
+    UpSafety(FlowGraph &g, Trace trace = Trace())
+        : UpSafety(g, trace, g._upsafety) {}
+
+    // Solve into result instead of the graph's UpSafety column.
+    UpSafety(FlowGraph &g, Trace trace, PredicateColumn result)
+        : Dataflow<UpSafetyProblem, Trace>(g, result, trace) {}
+
+    void compute() {
+      this->_g._upSafetyStale = false;
+      Dataflow<UpSafetyProblem, Trace>::compute();
+    }
+
+    std::vector<int> recompute(const std::vector<int> &seeds) {
+      this->_g._upSafetyStale = false;
+      return Dataflow<UpSafetyProblem, Trace>::recompute(seeds);
+    }
+  };
+
+  // DownSafety and UpSafety do not read each other, so compute() runs them
+  // on two threads. Both results share words of the predicate store, so
+  // the threads solve into scratch columns that are copied in afterwards.
+  // With tracing enabled, or on a single core, they run one after the other.
+  template <typename Trace = Tracer<true>> class Safety {
+  public:
+    Safety(FlowGraph &g, Trace trace = Trace()) : _g(g), _trace(trace) {}
+
+    long getVisitCount() const { return _visits; }
+
+    void compute() {
+      PassRecorder recorder(_g._passStats, "Safety");
+      // The solvers only read the graph and the local predicates; set them
+      // up before the threads start.
+      _g.finalize();
+      _g.computeLocalPredicates();
+      if (_g._engine == Engine::SCC) {
+        _g.computeSCCs();
+      }
+      int size = _g._size;
+      std::vector<std::uint16_t> scratch(2 * size, 0);
+      DownSafety<Trace> d_safe{_g, _trace, {scratch.data(), 1, size}};
+      UpSafety<Trace> u_safe{_g, _trace, {scratch.data() + size, 1, size}};
+      bool parallel = std::is_same_v<Trace, NoTrace> &&
+                      std::thread::hardware_concurrency() > 1;
+      parallelFor(2, parallel ? 2 : 1, [&](std::size_t k) {
+        if (k == 0) {
+          d_safe.compute();
+        } else {
+          u_safe.compute();
+        }
+      });
+      for (int i = 0; i < size; ++i) {
+        _g._downsafety[i] = scratch[i];
+        _g._upsafety[i] = scratch[size + i];
+      }
+      _g._upSafetyStale = false;
+      _visits = d_safe.getVisitCount() + u_safe.getVisitCount();
+      recorder.stats().visits = _visits;
+    }
+
+  private:
+    FlowGraph &_g;
+    Trace _trace;
+    long _visits = 0;
+  };
+
+  // Earliestness is local once both safety predicates are known: v is an
+  // earliest point if some predecessor u is the entry, or a block below
+  // which a + b is neither available nor computable, i.e. !comp(u) and
+  // either killed(u) or neither up- nor down-safe. One pass, no fixpoint.
+  // compute() runs UpSafety first if an edit made it stale; DownSafety must
+  // be current.
+  template <typename Trace = Tracer<true>> class Earliestness {
+  public:
+    Earliestness(FlowGraph &g, Trace trace = Trace())
+        : _g(g), _size(g._size), _result(g._earliestness), _trace(trace) {}
+
+    ~Earliestness() {}
+
+    // Number of nodes evaluated by the last compute() or recompute().
+    long getVisitCount() const { return _visits; }
+
+    void compute() {
+      _g.finalize();
+      if (_g._upSafetyStale) {
+        UpSafety<Trace>{_g, _trace}.compute();
+      }
+
+      PassRecorder recorder(_g._passStats, "Earliestness");
+      long changes = 0;
+      _result[0] = 1;
+      for (int i = 1; i < _size; ++i) {
+        _result[i] = 0;
+        changes += evaluate(i, nullptr);
+      }
+      _visits = _size - 1;
+      recorder.stats().visits = _visits;
+      recorder.stats().changes = changes;
+      recorder.stats().iterations = 1;
+      _trace.flush();
+    }
+
+    // Re-evaluate the seed nodes after their predecessors' predicates
+    // changed. Returns the nodes whose value changed.
+    std::vector<int> recompute(const std::vector<int> &seeds) {
+      PassRecorder recorder(_g._passStats, "Earliestness.recompute");
+      std::vector<std::pair<int, int>> old;
+      long changes = 0;
+      _visits = 0;
+      for (int v : seeds) {
+        if (v != 0) {
+          changes += evaluate(v, &old);
+          ++_visits;
+        }
+      }
+      recorder.stats().visits = _visits;
+      recorder.stats().changes = changes;
+      recorder.stats().iterations = 1;
+      _trace.flush();
+      return _g.collectChanged(_result, old);
+    }
+
+  private:
+    static constexpr std::uint16_t kComp =
+        PredicateStore::mask(Predicate::Comp);
+    static constexpr std::uint16_t kKilled =
+        PredicateStore::mask(Predicate::Killed);
+    static constexpr std::uint16_t kSafe =
+        PredicateStore::mask(Predicate::DownSafety) |
+        PredicateStore::mask(Predicate::UpSafety);
+
+    FlowGraph &_g;
+    int _size;
+    PredicateColumn _result;
+    long _visits = 0;
+    Trace _trace;
+
+    // Returns 1 if the value changed.
+    int evaluate(int tmp_v, std::vector<std::pair<int, int>> *old) {
+      int tmp_res_v = 0;
+      for (auto tmp_u : _g.getPrecessors(tmp_v)) {
+        // The entry node is no placement point, so nothing is available
+        // on its out-edges even where it is down-safe.
+        if (tmp_u == 0) {
+          tmp_res_v = 1;
+          break;
+        }
+        // All predicates of tmp_u come from a single load.
+        std::uint16_t flags = _g._store.flags(tmp_u);
+        if (!(flags & kComp) && ((flags & kKilled) || !(flags & kSafe))) {
+          tmp_res_v = 1;
+          break;
+        }
+      }
+      if (tmp_res_v == _result[tmp_v]) {
+        return 0;
+      }
+      _trace.update("Earliestness", tmp_v, tmp_res_v);
+      _g.remember(_result, tmp_v, old);
+      _result[tmp_v] = tmp_res_v;
+      return 1;
+    }
+  };
+
+  // Delay, then Latest from it in one local pass.
+  template <typename Trace = Tracer<true>>
+  class DelayLatest : public Dataflow<DelayProblem, Trace> {
+  public:
+    DelayLatest(FlowGraph &g, Trace trace = Trace())
+        : Dataflow<DelayProblem, Trace>(g, g._delay, trace) {}
+
+    void compute() {
+      Dataflow<DelayProblem, Trace>::compute();
+      PassRecorder recorder(this->_g._passStats, "Latest");
+      for (int i = 1; i < this->_size - 1; ++i) {
+        int value = latest(i);
+        recorder.stats().changes += value != this->_g._latest[i];
+        this->_g._latest[i] = value;
+      }
+      recorder.stats().visits = this->_size - 2;
+      recorder.stats().iterations = 1;
+    }
+
+    // Re-solve Delay from the seed nodes, then Latest at latestSeeds and
+    // around every node whose Delay changed. Returns the nodes whose Latest
+    // changed.
+    std::vector<int> recompute(const std::vector<int> &seeds,
+                               std::vector<int> latestSeeds) {
+      FlowGraph &g = this->_g;
+      for (int u : Dataflow<DelayProblem, Trace>::recompute(seeds)) {
+        latestSeeds.push_back(u);
+        for (auto tmp_u : g.getPrecessors(u)) {
+          latestSeeds.push_back(tmp_u);
+        }
+      }
+
+      PassRecorder recorder(g._passStats, "Latest.recompute");
+      std::vector<std::pair<int, int>> oldLatest;
+      for (int u : latestSeeds) {
+        if (u > 0 && u < this->_size - 1) {
+          g.remember(g._latest, u, &oldLatest);
+          g._latest[u] = latest(u);
+          ++recorder.stats().visits;
+        }
+      }
+      std::vector<int> changed = g.collectChanged(g._latest, oldLatest);
+      recorder.stats().changes = changed.size();
+      recorder.stats().iterations = 1;
+      return changed;
+    }
+
+  private:
+    int latest(int i) const {
+      int tmp_res_delay_succ = 1;
+      for (auto tmp_v : this->_g.getSuccessors(i)) {
+        tmp_res_delay_succ = tmp_res_delay_succ && this->_g._delay[tmp_v];
+      }
+      return this->_result[i] &&
+             (this->_g._used[i] || (!tmp_res_delay_succ));
+    }
+  };
+
+  template <typename Trace = Tracer<true>>
+  class Isolated : public Dataflow<IsolatedProblem, Trace> {
+  public:
+    Isolated(FlowGraph &g, Trace trace = Trace())
+        : Dataflow<IsolatedProblem, Trace>(g, g._isolated, trace) {}
+  };
+
+  // Lazy Strength Reduction, after the pipeline ran in strength reduction
+  // mode: Live, then Update in one local pass. An injured node needs the
+  // update h := h + c * b exactly when h is live at its exit; since Delay
+  // already moves insertions past injuries wherever that does not put them
+  // into a loop, the remaining updates are the ones a loop forces.
+  template <typename Trace = Tracer<true>>
+  class StrengthReduction : public Dataflow<LiveProblem, Trace> {
+  public:
+    StrengthReduction(FlowGraph &g, Trace trace = Trace())
+        : Dataflow<LiveProblem, Trace>(g, g._live, trace) {}
+
+    void compute() {
+      Dataflow<LiveProblem, Trace>::compute();
+      FlowGraph &g = this->_g;
+      PassRecorder recorder(g._passStats, "Update");
+      for (int i = 1; i < this->_size - 1; ++i) {
+        int value = 0;
+        if (g._injured[i] && !g._killed[i]) {
+          for (auto tmp_v : g.getSuccessors(i)) {
+            value = value || g._live[tmp_v];
+          }
+        }
+        recorder.stats().changes += value != g._update[i];
+        g._update[i] = value;
+      }
+      recorder.stats().visits = this->_size - 2;
+      recorder.stats().iterations = 1;
+    }
+  };
+
+  // Keeps the LCM solution of a graph current under small edits. compute()
+  // solves from scratch; after addEdge/removeEdge/setUsed/setKilled or
+  // addInstruction, update() re-solves only the nodes the edits can reach
+  // and ends with the same results as a fresh compute(). Node counts must
+  // not change in between (split critical edges before compute()).
+  template <typename Trace = Tracer<true>> class Incremental {
+  public:
+    Incremental(FlowGraph &g, Trace trace = Trace()) : _g(g), _trace(trace) {}
+
+    // Nodes popped from the worklists by the last compute() or update().
+    long getVisitCount() const { return _visits; }
+
+    void compute() {
+      Safety<Trace> safety{_g, _trace};
+      safety.compute();
+      Earliestness<Trace> early{_g, _trace};
+      early.compute();
+      DelayLatest<Trace> delay{_g, _trace};
+      delay.compute();
+      Isolated<Trace> isolated{_g, _trace};
+      isolated.compute();
+      _visits = safety.getVisitCount() + early.getVisitCount() +
+                delay.getVisitCount() + isolated.getVisitCount();
+      _g._edgeEdits.clear();
+      _g._nodeEdits.clear();
+      _g._trackEdits = true;
+    }
+
+    void update() {
+      _g.finalize();
+      std::vector<int> sources, targets;
+      for (auto [u, v] : _g._edgeEdits) {
+        sources.push_back(u);
+        targets.push_back(v);
+      }
+      // An edited node changes its own backward equations and the forward
+      // ones of its successors; Isolated reads it from its predecessors.
+      std::vector<int> &nodes = _g._nodeEdits;
+      std::vector<int> succs = _g.neighbours(nodes, true);
+
+      DownSafety<Trace> d_safe{_g, _trace};
+      std::vector<int> dsChanged = d_safe.recompute(concat(sources, nodes));
+
+      UpSafety<Trace> u_safe{_g, _trace};
+      std::vector<int> usChanged = u_safe.recompute(concat(targets, succs));
+
+      Earliestness<Trace> early{_g, _trace};
+      std::vector<int> earlySeeds = concat(targets, succs);
+      append(earlySeeds, _g.neighbours(dsChanged, true));
+      append(earlySeeds, _g.neighbours(usChanged, true));
+      std::vector<int> earlyChanged = early.recompute(earlySeeds);
+
+      DelayLatest<Trace> delay{_g, _trace};
+      std::vector<int> delaySeeds = concat(earlySeeds, dsChanged);
+      append(delaySeeds, earlyChanged);
+      std::vector<int> latestChanged =
+          delay.recompute(delaySeeds, concat(sources, nodes));
+
+      Isolated<Trace> isolated{_g, _trace};
+      std::vector<int> isoSeeds = concat(sources, _g.neighbours(nodes, false));
+      append(isoSeeds, _g.neighbours(latestChanged, false));
+      isolated.recompute(isoSeeds);
+
+      _visits = d_safe.getVisitCount() + u_safe.getVisitCount() +
+                early.getVisitCount() + delay.getVisitCount() +
+                isolated.getVisitCount();
+      _g._edgeEdits.clear();
+      _g._nodeEdits.clear();
+    }
+
+  private:
+    FlowGraph &_g;
+    Trace _trace;
+    long _visits = 0;
+
+    static void append(std::vector<int> &to, const std::vector<int> &from) {
+      to.insert(to.end(), from.begin(), from.end());
+    }
+
+    static std::vector<int> concat(std::vector<int> a,
+                                   const std::vector<int> &b) {
+      append(a, b);
+      return a;
+    }
+  };
+
+  // Partial dead code elimination (Knoop, Ruething, Steffen) of the
+  // assignment x := a + b in the instruction lists. apply() sinks every
+  // occurrence as far as Sinkable allows: it leaves its block and is put
+  // back at the entry of the first blocks that read x or change a, and at
+  // the exit of blocks some of whose successors it cannot reach on all
+  // paths. Occurrences that reach the exit vanish. Then every assignment
+  // whose x is dead (XLive) is removed. Critical edges must be split first
+  // (splitCriticalEdges): across one, an assignment can be sunk twice and
+  // optimize() need not terminate.
+  template <typename Trace = Tracer<true>> class PartialDeadCode {
+  public:
+    PartialDeadCode(FlowGraph &g, Trace trace = Trace())
+        : _g(g), _sink(g, g._sinkable, trace), _live(g, g._xlive, trace) {}
+
+    // One round of sinking and dead assignment elimination. Returns whether
+    // any instruction list changed.
+    bool apply() {
+      FlowGraph &g = _g;
+      PassRecorder recorder(g._passStats, "PDCE");
+      g.finalize();
+      g.computeLocalPredicates();
+      g.computeAssignPredicates();
+      _sink.compute();
+      _toEntry.clear();
+      _toExit.clear();
+      _removed.clear();
+
+      int size = g._size;
+      std::vector<char> delayedIn(size, 0);
+      for (int v = 1; v < size; ++v) {
+        delayedIn[v] = !g.getPrecessors(v).empty();
+        for (auto tmp_u : g.getPrecessors(v)) {
+          delayedIn[v] = delayedIn[v] && g._sinkable[tmp_u];
+        }
+      }
+      std::vector<std::vector<Instr>> before(size);
+      for (int u = 1; u < size - 1; ++u) {
+        std::uint8_t local = g._assignLocal[u];
+        bool entry = delayedIn[u] && (local & kAssignBlocked);
+        bool exit = false;
+        if (g._sinkable[u]) {
+          for (auto tmp_v : g.getSuccessors(u)) {
+            exit = exit || !delayedIn[tmp_v];
+          }
+        }
+        if (!entry && !exit && !(local & kAssignLeaves)) {
+          continue;
+        }
+        std::vector<Instr> &code = g.materialize(u);
+        before[u] = code;
+        if (local & kAssignLeaves) {
+          auto last = std::find(code.rbegin(), code.rend(), Instr::Assign);
+          code.erase(std::next(last).base());
+        }
+        if (entry) {
+          code.insert(code.begin(), Instr::Assign);
+          _toEntry.push_back(u);
+        }
+        if (exit) {
+          code.push_back(Instr::Assign);
+          _toExit.push_back(u);
+        }
+      }
+
+      g.computeAssignPredicates();
+      _live.compute();
+      for (int u = 1; u < size - 1; ++u) {
+        std::vector<Instr> &code = g._code[u];
+        int live = 0;
+        for (auto tmp_v : g.getSuccessors(u)) {
+          live = live || g._xlive[tmp_v];
+        }
+        for (int i = static_cast<int>(code.size()) - 1; i >= 0; --i) {
+          if (code[i] == Instr::UseX) {
+            live = 1;
+          } else if (code[i] == Instr::Assign) {
+            if (!live) {
+              if (before[u].empty()) {
+                before[u] = code;
+              }
+              code.erase(code.begin() + i);
+              _removed.push_back(u);
+            }
+            live = 0;
+          }
+        }
+      }
+
+      bool changed = false;
+      for (int u = 1; u < size - 1; ++u) {
+        if (!before[u].empty() && before[u] != g._code[u]) {
+          g._dirtyBlocks.push_back(u);
+          g.logNode(u);
+          changed = true;
+        }
+      }
+      g.computeLocalPredicates();
+      recorder.stats().visits = _sink.getVisitCount() + _live.getVisitCount();
+      recorder.stats().iterations = 1;
+      return changed;
+    }
+
+    // Alternate apply() with an LCM update until the code no longer
+    // changes: every round moves uses of a + b, so LCM places them anew.
+    // Returns the number of rounds that changed something.
+    int optimize(Incremental<Trace> &lcm) {
+      int rounds = 0;
+      while (apply()) {
+        lcm.update();
+        ++rounds;
+      }
+      return rounds;
+    }
+
+    // What the last apply() did.
+    void getPlacement(std::ostream &outs = std::cout) const {
+      auto print = [&](const char *title, const std::vector<int> &nodes) {
+        outs << title;
+        for (int u : nodes) {
+          _g.printNode(u, outs);
+        }
+        outs << "\n";
+      };
+      outs << "[Get Placement of PDCE]:\n";
+      print("[Sink x := a + b to the Entry of]: ", _toEntry);
+      print("[Sink x := a + b to the Exit of]: ", _toExit);
+      print("[Dead Assignment Removed from]: ", _removed);
+    }
+
+  private:
+    FlowGraph &_g;
+    Dataflow<SinkProblem, Trace> _sink;
+    Dataflow<LiveXProblem, Trace> _live;
+    std::vector<int> _toEntry;
+    std::vector<int> _toExit;
+    std::vector<int> _removed;
+  };
+
+private:
+  PredicateStore _store;
+  PredicateColumn _used;
+  PredicateColumn _killed;
+  PredicateColumn _comp;
+  PredicateColumn _downsafety;
+  PredicateColumn _upsafety;
+  PredicateColumn _earliestness;
+  PredicateColumn _delay;
+  PredicateColumn _latest;
+  PredicateColumn _isolated;
+  PredicateColumn _injured;
+  // The kill flag of setKilled() or the instruction list; _killed, the
+  // !TRANSP the analyses read, adds injuries outside strength reduction.
+  PredicateColumn _kills;
+  PredicateColumn _live;
+  PredicateColumn _update;
+  PredicateColumn _sinkable;
+  PredicateColumn _xlive;
+  bool _strengthReduction = false;
+  std::vector<std::vector<Instr>> _code;
+  // Local facts of partial dead code elimination, see
+  // computeAssignPredicates().
+  std::vector<std::uint8_t> _assignLocal;
+  static constexpr std::uint8_t kAssignLeaves = 1;  // sinks out of the block
+  static constexpr std::uint8_t kAssignOpaque = 2;  // stops a sinking one
+  static constexpr std::uint8_t kAssignBlocked = 4; // ... before assigning x
+  static constexpr std::uint8_t kAssignReadsX = 8;  // ... before assigning x
+  static constexpr std::uint8_t kAssignWritesX = 16;
+  std::vector<int> _dirtyBlocks;
+
+  // Edits since the last Incremental::compute()/update(), and scratch marks
+  // for the nodes an incremental re-solve has touched.
+  bool _trackEdits = false;
+  // Set by every edit, cleared by UpSafety; see Earliestness::compute().
+  bool _upSafetyStale = true;
+  std::vector<std::pair<int, int>> _edgeEdits;
+  std::vector<int> _nodeEdits;
+  std::vector<char> _mark;
+
+  // The Elimination engine: solve one analysis by T1/T2 reduction (see
+  // EliminationSolver for node and edge) and fill in stats. Returns false,
+  // leaving result alone, when another engine is selected or the graph is
+  // irreducible, in which case the caller iterates as usual.
+  template <typename Node, typename Edge>
+  bool eliminate(bool forward, bool meetAnd, PredicateColumn result,
+                 PassStats &stats, Node node, Edge edge) {
+    if (_engine != Engine::Elimination) {
+      return false;
+    }
+    EliminationSolver solver(*this, forward, meetAnd);
+    long changes = 0;
+    if (!solver.solve(node, edge, [&](int u, int value) {
+          result[u] = value;
+          changes += value != meetAnd;
+        })) {
+      return false;
+    }
+    // Counted from the top value, as if iterating; one sweep to fold the
+    // graph and one to recover the values.
+    stats.visits = solver.getSteps();
+    stats.changes = changes;
+    stats.iterations = 2;
+    return true;
+  }
+
+  // Reset-and-repropagate: facts can only be recomputed downwards from the
+  // top value (1 for the greatest fixpoints, 0 for Earliestness), so every
+  // seed, and every node off top that depends on a reset node, is put back
+  // to top. The remaining nodes keep a valid justification that avoids the
+  // seeds. Old values of reset nodes are appended to old.
+  template <typename Deps>
+  void resetRegion(PredicateColumn result, int top,
+                   const std::vector<int> &seeds, int fixedNode,
+                   std::vector<std::pair<int, int>> &old, Deps deps) {
+    if (static_cast<int>(_mark.size()) != _size) {
+      _mark.assign(_size, 0);
+    }
+    std::size_t begin = old.size();
+    for (int u : seeds) {
+      if (u != fixedNode) {
+        remember(result, u, &old);
+      }
+    }
+    for (std::size_t k = begin; k < old.size(); ++k) {
+      int u = old[k].first;
+      result[u] = top;
+      for (int v : deps(u)) {
+        if (v != fixedNode && result[v] != top) {
+          remember(result, v, &old);
+        }
+      }
+    }
+  }
+
+  // The instruction list of u, spelled out from the use and kill flags if
+  // the block has none yet (a use comes before the kill).
+  std::vector<Instr> &materialize(int u) {
+    if (_code[u].empty()) {
+      if (_used[u]) {
+        _code[u].push_back(Instr::Use);
+      }
+      if (_killed[u]) {
+        _code[u].push_back(Instr::Kill);
+      }
+    }
+    return _code[u];
+  }
+
+  // Record the value of u before its first change in this re-solve.
+  void remember(PredicateColumn result, int u,
+                std::vector<std::pair<int, int>> *old) {
+    if (old && !_mark[u]) {
+      _mark[u] = 1;
+      old->emplace_back(u, result[u]);
+    }
+  }
+
+  // Clear the marks of old and return the nodes whose value differs now.
+  std::vector<int> collectChanged(PredicateColumn result,
+                                  const std::vector<std::pair<int, int>> &old) {
+    std::vector<int> changed;
+    for (auto [u, value] : old) {
+      _mark[u] = 0;
+      if (result[u] != value) {
+        changed.push_back(u);
+      }
+    }
+    return changed;
+  }
+
+  std::vector<int> neighbours(const std::vector<int> &nodes, bool succs) const {
+    std::vector<int> res;
+    for (int u : nodes) {
+      for (int v : succs ? getSuccessors(u) : getPrecessors(u)) {
+        res.push_back(v);
+      }
+    }
+    return res;
+  }
+
+  // !TRANSP as the analyses see it: the node's own kill, or an injury
+  // outside strength reduction mode.
+  void updateKilled(int u) {
+    _killed[u] = _kills[u] || (_injured[u] && !_strengthReduction);
+    _comp[u] = _used[u] && !_killed[u];
+  }
+
+  void logNode(int u) {
+    _upSafetyStale = true;
+    if (_trackEdits) {
+      _nodeEdits.push_back(u);
+    }
+  }
+
+  void logEdge(int u, int v) {
+    _upSafetyStale = true;
+    if (_trackEdits) {
+      _edgeEdits.emplace_back(u, v);
+    }
+  }
+
+  void growAllNodes(int count) {
+    if (count == 0) {
+      return;
+    }
+    _upSafetyStale = true;
+    _code.insert(_code.end() - 1, count, std::vector<Instr>());
+    _store.grow(count);
+    bindColumns();
+  }
+
+  void bindColumns() {
+    _used = _store.column(Predicate::Used);
+    _killed = _store.column(Predicate::Killed);
+    _comp = _store.column(Predicate::Comp);
+    _downsafety = _store.column(Predicate::DownSafety);
+    _upsafety = _store.column(Predicate::UpSafety);
+    _earliestness = _store.column(Predicate::Earliestness);
+    _delay = _store.column(Predicate::Delay);
+    _latest = _store.column(Predicate::Latest);
+    _isolated = _store.column(Predicate::Isolated);
+    _injured = _store.column(Predicate::Injured);
+    _kills = _store.column(Predicate::Kills);
+    _live = _store.column(Predicate::Live);
+    _update = _store.column(Predicate::Update);
+    _sinkable = _store.column(Predicate::Sinkable);
+    _xlive = _store.column(Predicate::XLive);
+  }
+
+  int isOptimalPoint(int i) const { return _latest[i] && !_isolated[i]; }
+
+  int isIsolatedComputation(int i) const {
+    return _latest[i] && _isolated[i];
+  }
+
+  int isRedundant(int i) const {
+    return _used[i] && !(_latest[i] && _isolated[i]);
+  }
+
+  // Shared DOT emitter of drawBCM/drawALCM/drawLCM: one pass over the nodes
+  // and one over the CSR successor lists, O(N + E) in total. drawLabel
+  // writes a node's label text and closing attributes; the run is recorded
+  // as pass.
+  template <typename DrawLabel>
+  void drawDot(const char *pass, const std::string &Filepath,
+               const char *nodeStyle, DrawLabel drawLabel) {
+    finalize();
+    PassRecorder recorder(_passStats, pass);
+    recorder.stats().visits = _size - 2;
+    BufferedWriter outs(Filepath);
+
+    outs << "digraph G {\n";
+    outs << nodeStyle;
+    outs << "\tedge[arrowhead=open;];\n";
+    outs << "\n";
+
+    for (int i = 1; i < _size - 1; i++) {
+      outs << "\tBB" << i << " [label=\"";
+      drawLabel(outs, i);
+      outs << "];\n";
+    }
+    outs << "\n";
+    for (int i = 1; i < _size - 1; i++) {
+      for (auto j : getSuccessors(i)) {
+        if (j != 0 && j != _size - 1) {
+          outs << "\tBB" << i << "->BB" << j << ";\n";
+        }
+      }
+    }
+    outs << "}\n";
+  }
+
+  void drawUse(BufferedWriter &outs, int i, int isPlaced) const {
+    if (_used[i]) {
+      outs << (isPlaced ? "... := h;\\n" : "... := a + b;\\n");
+    }
+  }
+
+  void drawKill(BufferedWriter &outs, int i) const {
+    if (_killed[i]) {
+      outs << "a := c;\\n";
+    }
+  }
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "bit_flow_graph.h"
+#include "flow_graph.h"
+
+// Live ranges of the temporary h that holds a + b under the three placement
+// strategies of a solved graph:
+//
+//   BCM   h := a + b at every down-safe earliest node, every use reads h
+//   ALCM  h := a + b at every latest node, every use reads h
+//   LCM   h := a + b at every optimal computation point, isolated
+//         computations stay a + b, every other use reads h
+//
+// Liveness is the usual backward union problem at block granularity:
+//
+//   LiveOut(n) = OR_s LiveIn(s)
+//   LiveIn(n)  = !Insert(n) && (Reads(n) || (!Killed(n) && LiveOut(n)))
+//
+// where a block that kills a + b recomputes any h it hands on (the last use
+// of an instruction list). h occupies a register in block n if it is live
+// at its entry or exit, or is inserted and read right there, and on edge
+// u -> v if it is live at the entry of v. For a BitFlowGraph every
+// expression has its own temporary; the report then also gives the largest
+// number of temporaries live in one block, the register pressure the
+// placement adds.
+class LifetimeReport {
+public:
+  enum class Strategy { BCM, ALCM, LCM };
+
+  struct Summary {
+    long blocks = 0; // (block, temporary) pairs with the temporary live
+    long edges = 0;  // (edge, temporary) pairs likewise
+    int maxLive = 0; // temporaries live in one block, at most
+    int maxLiveNode = -1;
+
+    long length() const { return blocks + edges; }
+  };
+
+  explicit LifetimeReport(const FlowGraph &g) : _g(g), _size(g.getSize()) {
+    build([&](Strategy s, int u, int) {
+      int latest = g.getLatest()[u], used = g.isUsed(u);
+      if (s == Strategy::BCM) {
+        return Local{g.getDownSafety()[u] && g.getEarliestness()[u], used,
+                     g.isKilled(u)};
+      }
+      if (s == Strategy::ALCM) {
+        return Local{latest, used, g.isKilled(u)};
+      }
+      int isolated = g.getIsolated()[u];
+      return Local{latest && !isolated, used && !(latest && isolated),
+                   g.isKilled(u)};
+    });
+  }
+
+  explicit LifetimeReport(const BitFlowGraph &g)
+      : _g(g), _size(g.getSize()), _numExprs(g.getNumExprs()),
+        _words((g.getNumExprs() + 63) / 64) {
+    build([&](Strategy s, int u, int e) {
+      int latest = g.isLatest(u, e), used = g.isUsed(u, e);
+      if (s == Strategy::BCM) {
+        return Local{g.isDownSafe(u, e) && g.isEarliest(u, e), used,
+                     g.isKilled(u, e)};
+      }
+      if (s == Strategy::ALCM) {
+        return Local{latest, used, g.isKilled(u, e)};
+      }
+      int isolated = g.isIsolated(u, e);
+      return Local{latest && !isolated, used && !(latest && isolated),
+                   g.isKilled(u, e)};
+    });
+  }
+
+  const Summary &getSummary(Strategy s) const {
+    return _summary[static_cast<int>(s)];
+  }
+
+  bool isLiveIn(Strategy s, int u, int expr = 0) const {
+    return test(_in[static_cast<int>(s)], u, expr);
+  }
+
+  bool isLiveOut(Strategy s, int u, int expr = 0) const {
+    return test(_out[static_cast<int>(s)], u, expr);
+  }
+
+  // Whether h lives anywhere in block u.
+  bool isLive(Strategy s, int u, int expr = 0) const {
+    return test(_live[static_cast<int>(s)], u, expr);
+  }
+
+  // The three strategies side by side, totalled over all temporaries.
+  void print(std::ostream &outs = std::cout) const {
+    auto row = [&](const char *title, auto field) {
+      outs << title;
+      const char *sep = "";
+      for (int s = 0; s < 3; ++s) {
+        outs << sep << kNames[s] << " " << field(_summary[s]);
+        sep = ", ";
+      }
+      outs << "\n";
+    };
+    outs << "[Temporary Lifetimes]:\n";
+    row("[Live Blocks]: ", [](const Summary &s) { return s.blocks; });
+    row("[Live Edges]: ", [](const Summary &s) { return s.edges; });
+    row("[Live Range Length]: ", [](const Summary &s) { return s.length(); });
+    row("[Max Live Temporaries]: ",
+        [](const Summary &s) { return s.maxLive; });
+  }
+
+  // The blocks and edges where the temporary of expr lives, per strategy.
+  void printRanges(std::ostream &outs = std::cout, int expr = 0) const {
+    for (int s = 0; s < 3; ++s) {
+      Strategy strategy = static_cast<Strategy>(s);
+      outs << "[Live Range under " << kNames[s] << "]: ";
+      for (int u = 1; u < _size - 1; ++u) {
+        if (isLive(strategy, u, expr)) {
+          _g.printNode(u, outs);
+        }
+      }
+      outs << "\n[Live Edges under " << kNames[s] << "]: ";
+      for (int u = 0; u < _size; ++u) {
+        for (int v : _g.getSuccessors(u)) {
+          if (isLiveIn(strategy, v, expr)) {
+            outs << u << "->" << v << ", ";
+          }
+        }
+      }
+      outs << "\n";
+    }
+  }
+
+private:
+  using Word = std::uint64_t;
+
+  struct Local {
+    int insert;
+    int reads;
+    int killed;
+  };
+
+  static constexpr const char *kNames[3] = {"BCM", "ALCM", "LCM"};
+
+  const CSRGraph &_g;
+  int _size;
+  int _numExprs = 1;
+  int _words = 1;
+  std::array<std::vector<Word>, 3> _in;
+  std::array<std::vector<Word>, 3> _out;
+  std::array<std::vector<Word>, 3> _live;
+  std::array<Summary, 3> _summary;
+
+  bool test(const std::vector<Word> &vec, int u, int expr) const {
+    return (vec[static_cast<std::size_t>(u) * _words + expr / 64] >>
+            (expr % 64)) &
+           1;
+  }
+
+  // local(s, u, expr) gives the block-local facts of expr in u under s.
+  template <typename LocalFn> void build(LocalFn local) {
+    std::size_t cells = static_cast<std::size_t>(_size) * _words;
+    std::vector<Word> insert, reads, transp;
+    for (int s = 0; s < 3; ++s) {
+      insert.assign(cells, 0);
+      reads.assign(cells, 0);
+      transp.assign(cells, 0);
+      for (int u = 0; u < _size; ++u) {
+        for (int e = 0; e < _numExprs; ++e) {
+          Local facts = local(static_cast<Strategy>(s), u, e);
+          std::size_t w = static_cast<std::size_t>(u) * _words + e / 64;
+          Word bit = Word(1) << (e % 64);
+          insert[w] |= facts.insert ? bit : 0;
+          reads[w] |= facts.reads ? bit : 0;
+          transp[w] |= facts.killed ? 0 : bit;
+        }
+      }
+      solve(s, insert, reads, transp);
+    }
+  }
+
+  void solve(int s, const std::vector<Word> &insert,
+             const std::vector<Word> &reads, const std::vector<Word> &transp) {
+    std::vector<Word> &in = _in[s], &out = _out[s], &live = _live[s];
+    std::size_t cells = static_cast<std::size_t>(_size) * _words;
+    in.assign(cells, 0);
+    out.assign(cells, 0);
+    live.assign(cells, 0);
+    std::vector<Word> tmp(_words);
+
+    Worklist worklist{_g.getPostOrderRank(), _g.getWorklistOrder()};
+    for (int u = 0; u < _size; ++u) {
+      worklist.push(u);
+    }
+    while (!worklist.empty()) {
+      int u = worklist.pop();
+      Word *o = out.data() + static_cast<std::size_t>(u) * _words;
+      std::fill(o, o + _words, Word(0));
+      for (int v : _g.getSuccessors(u)) {
+        const Word *i = in.data() + static_cast<std::size_t>(v) * _words;
+        for (int w = 0; w < _words; ++w) {
+          o[w] |= i[w];
+        }
+      }
+      std::size_t base = static_cast<std::size_t>(u) * _words;
+      Word diff = 0;
+      for (int w = 0; w < _words; ++w) {
+        Word value =
+            ~insert[base + w] & (reads[base + w] | (transp[base + w] & o[w]));
+        diff |= value ^ in[base + w];
+        in[base + w] = value;
+      }
+      if (diff) {
+        for (int p : _g.getPrecessors(u)) {
+          worklist.push(p);
+        }
+      }
+    }
+
+    Summary &sum = _summary[s];
+    sum = Summary{};
+    for (int u = 0; u < _size; ++u) {
+      std::size_t base = static_cast<std::size_t>(u) * _words;
+      int count = 0;
+      for (int w = 0; w < _words; ++w) {
+        live[base + w] = in[base + w] | out[base + w] |
+                         (insert[base + w] & reads[base + w]);
+        count += std::popcount(live[base + w]);
+      }
+      sum.blocks += count;
+      if (count > sum.maxLive) {
+        sum.maxLive = count;
+        sum.maxLiveNode = u;
+      }
+      for (int v : _g.getSuccessors(u)) {
+        for (int w = 0; w < _words; ++w) {
+          sum.edges += std::popcount(in[static_cast<std::size_t>(v) * _words +
+                                        w]);
+        }
+      }
+    }
+  }
+};
@@ -1,497 +1,20 @@
+#include <charconv>
 #include <fstream>
 #include <iostream>
-#include <queue>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
-class FlowGraph {
-public:
-  FlowGraph(int size) : _size(size + 2) {
-    _edges = new int[_size * _size]();
-    _used = new int[_size]();
-    _killed = new int[_size]();
-    _downsafety = new int[_size];
-    _earliestness = new int[_size];
-    _delay = new int[_size];
-    _latest = new int[_size]();
-    _isolated = new int[_size];
-  }
-
-  ~FlowGraph() {
-    delete _edges;
-    delete _used;
-    delete _killed;
-    delete _downsafety;
-    delete _earliestness;
-    delete _delay;
-    delete _latest;
-    delete _isolated;
-  }
-
-  void addEdge(int u, int v) { _edges[u * _size + v] = 1; }
-
-  void setUsed(int u) { _used[u] = 1; }
-
-  void setKilled(int u) { _killed[u] = 1; }
-
-  std::vector<int> getPrecessors(int v) const {
-    std::vector<int> res;
-    for (int u = 0; u < _size; ++u) {
-      if (_edges[u * _size + v] == 1) {
-        res.emplace_back(u);
-      }
-    }
-    return res;
-  }
-
-  std::vector<int> getSuccessors(int u) const {
-    std::vector<int> res;
-    for (int v = 0; v < _size; ++v) {
-      if (_edges[u * _size + v] == 1) {
-        res.emplace_back(v);
-      }
-    }
-    return res;
-  }
-
-  int *getDownSafety() const { return _downsafety; }
-
-  int *getEarliestness() const { return _earliestness; }
-
-  int *getDelay() const { return _delay; }
-
-  int *getLatest() const { return _latest; }
-
-  int *getIsolated() const { return _isolated; }
-
-  void printVector(int *vec) const {
-    for (int i = 1; i < _size - 1; ++i) {
-      if (vec[i] == 1) {
-        std::cout << i << ", ";
-      }
-    }
-    std::cout << "\n";
-  }
-
-  void getPlacementBCM() {
-    std::cout << "[Get Placement of BCM]: ";
-    for (int i = 1; i < _size - 1; ++i) {
-      if ((_downsafety[i] == 1) && (_earliestness[i] == 1)) {
-        std::cout << i << ", ";
-      }
-    }
-    std::cout << "\n";
-  }
-
-  void getPlacementLCM() {
-    std::cout << "[Get Placement of LCM]:\n";
-    std::cout << "[Optimal Computation Points]: ";
-    for (int i = 1; i < _size - 1; ++i) {
-      if ((_latest[i] == 1) && (_isolated[i] == 0)) {
-        std::cout << i << ", ";
-      }
-    }
-    std::cout << "\n";
-
-    std::cout << "[Isolated Computation]: ";
-    for (int i = 1; i < _size - 1; ++i) {
-      if ((_latest[i] == 1) && (_isolated[i] == 1)) {
-        std::cout << i << ", ";
-      }
-    }
-    std::cout << "\n";
-
-    std::cout << "[Redundant Occurrence]: ";
-    for (int i = 1; i < _size - 1; ++i) {
-      if ((_used[i] == 1) && !((_latest[i] == 1) && (_isolated[i] == 1))) {
-        std::cout << i << ", ";
-      }
-    }
-    std::cout << "\n";
-  }
-
-  void drawBCM(std::string Filepath, int isPlaced) {
-    std::ofstream dotOuts;
-    dotOuts.open(Filepath, std::ios::out | std::ios::trunc);
-
-    dotOuts << "digraph G {\n";
-    dotOuts << "\tnode[shape=box;];\n";
-    dotOuts << "\tedge[arrowhead=open;];\n";
-    dotOuts << "\n";
-
-    for (int i = 1; i < _size - 1; i++) {
-      drawNodesBCM(dotOuts, i, _used[i], _killed[i], isPlaced, _downsafety[i],
-                   _earliestness[i]);
-    }
-    dotOuts << "\n";
-    for (int i = 1; i < _size - 1; i++) {
-      for (int j = 1; j < _size - 1; j++) {
-        if (_edges[i * _size + j] == 1) {
-          drawEdges(dotOuts, i, j);
-        }
-      }
-    }
-    dotOuts << "}\n";
-
-    dotOuts.close();
-  }
-
-  void drawALCM(std::string Filepath, int isPlaced) {
-    std::ofstream dotOuts;
-    dotOuts.open(Filepath, std::ios::out | std::ios::trunc);
-
-    dotOuts << "digraph G {\n";
-    dotOuts << "\tnode[shape=box;];\n";
-    dotOuts << "\tedge[arrowhead=open;];\n";
-    dotOuts << "\n";
-
-    for (int i = 1; i < _size - 1; i++) {
-      drawNodesALCM(dotOuts, i, _used[i], _killed[i], isPlaced, _delay[i],
-                    _latest[i]);
-    }
-    dotOuts << "\n";
-    for (int i = 1; i < _size - 1; i++) {
-      for (int j = 1; j < _size - 1; j++) {
-        if (_edges[i * _size + j] == 1) {
-          drawEdges(dotOuts, i, j);
-        }
-      }
-    }
-    dotOuts << "}\n";
-
-    dotOuts.close();
-  }
-
-  void drawLCM(std::string Filepath) {
-    std::ofstream dotOuts;
-    dotOuts.open(Filepath, std::ios::out | std::ios::trunc);
-
-    dotOuts << "digraph G {\n";
-    dotOuts << "\tnode[shape=box; color=black;];\n";
-    dotOuts << "\tedge[arrowhead=open;];\n";
-    dotOuts << "\n";
-
-    for (int i = 1; i < _size - 1; i++) {
-      drawNodesLCM(dotOuts, i, _killed[i], (_latest[i] && (!_isolated[i])),
-                   (_latest[i] && _isolated[i]),
-                   (_used[i] && !(_latest[i] && _isolated[i])));
-    }
-    dotOuts << "\n";
-    for (int i = 1; i < _size - 1; i++) {
-      for (int j = 1; j < _size - 1; j++) {
-        if (_edges[i * _size + j] == 1) {
-          drawEdges(dotOuts, i, j);
-        }
-      }
-    }
-    dotOuts << "}\n";
-
-    dotOuts.close();
-  }
-
-  class DownSafety {
-  public:
-    DownSafety(FlowGraph &g) : _g(g), _size(g._size), _result(g._downsafety) {}
-
-    ~DownSafety() {}
-
-    void compute() {
-      for (int i = 0; i < _size - 1; ++i) {
-        _result[i] = 1;
-      }
-      _result[_size - 1] = 0;
-
-      std::queue<int> worklist{};
-      for (int i = 0; i < _size - 1; ++i) {
-        worklist.push(i);
-      }
-
-      while (!worklist.empty()) {
-        int tmp_u = worklist.front();
-        worklist.pop();
-        int tmp_res_u = !_g._killed[tmp_u];
-
-        for (auto tmp_v : _g.getSuccessors(tmp_u)) {
-          tmp_res_u = tmp_res_u && _result[tmp_v];
-        }
-
-        tmp_res_u = tmp_res_u || _g._used[tmp_u];
-        if (tmp_res_u != _result[tmp_u]) {
-          std::cout << "[Update] D-Safe[" << tmp_u
-                    << "] := " << ((tmp_res_u == 1) ? "True" : "False") << "\n";
-          _result[tmp_u] = tmp_res_u;
-          for (auto tmp_u_prec : _g.getPrecessors(tmp_u)) {
-            worklist.push(tmp_u_prec);
-            // std::cout << "[Debug] Add to worklist: " << tmp_u_prec << "\n";
-          }
-        }
-      }
-    }
-
-  private:
-    FlowGraph &_g;
-    int _size;
-    int *_result;
-  };
-
-  class Earliestness {
-  public:
-    Earliestness(FlowGraph &g)
-        : _g(g), _size(g._size), _result(g._earliestness) {}
-
-    ~Earliestness() {}
-
-    void compute() {
-      for (int i = 1; i < _size; ++i) {
-        _result[i] = 0;
-      }
-      _result[0] = 1;
-
-      std::queue<int> worklist{};
-      for (int i = _size - 2; i > 0; --i) {
-        worklist.push(i);
-      }
-
-      while (!worklist.empty()) {
-        int tmp_v = worklist.front();
-        worklist.pop();
-        int tmp_res_v = 0;
-
-        for (auto tmp_u : _g.getPrecessors(tmp_v)) {
-          int tmp =
-              (!_g._downsafety[tmp_u] && _result[tmp_u]) || (_g._killed[tmp_u]);
-          tmp_res_v = tmp_res_v || tmp;
-        }
-        if (tmp_res_v != _result[tmp_v]) {
-          std::cout << "[Update] Earliestness[" << tmp_v
-                    << "] := " << ((tmp_res_v == 1) ? "True" : "False") << "\n";
-          _result[tmp_v] = tmp_res_v;
-          for (auto tmp_v_succ : _g.getSuccessors(tmp_v)) {
-            worklist.push(tmp_v_succ);
-            // std::cout << "[Debug] Add to worklist: " << tmp_u_prec << "\n";
-          }
-        }
-      }
-    }
-
-  private:
-    FlowGraph &_g;
-    int _size;
-    int *_result;
-  };
-
-  class DelayLatest {
-  public:
-    DelayLatest(FlowGraph &g) : _g(g), _size(g._size), _result(g._delay) {}
-
-    ~DelayLatest() {}
-
-    void compute() {
-      for (int i = 1; i < _size; ++i) {
-        _result[i] = 1;
-      }
-      _result[0] = 0;
-
-      std::queue<int> worklist{};
-      for (int i = _size - 2; i > 0; --i) {
-        worklist.push(i);
-      }
-
-      while (!worklist.empty()) {
-        int tmp_v = worklist.front();
-        worklist.pop();
-        int tmp_res_v = 1;
-
-        for (auto tmp_u : _g.getPrecessors(tmp_v)) {
-          int tmp = (!_g._used[tmp_u]) && _result[tmp_u];
-          tmp_res_v = tmp_res_v && tmp;
-        }
-        tmp_res_v =
-            tmp_res_v || (_g._downsafety[tmp_v] && _g._earliestness[tmp_v]);
-
-        if (tmp_res_v != _result[tmp_v]) {
-          std::cout << "[Update] Delay[" << tmp_v
-                    << "] := " << ((tmp_res_v == 1) ? "True" : "False") << "\n";
-          _result[tmp_v] = tmp_res_v;
-
-          for (auto tmp_v_succ : _g.getSuccessors(tmp_v)) {
-            worklist.push(tmp_v_succ);
-            // std::cout << "[Debug] Add to worklist: " << tmp_u_prec << "\n";
-          }
-        }
-      }
-
-      for (int i = 1; i < _size - 1; ++i) {
-        int tmp_res_delay_succ = 1;
-        for (auto tmp_v : _g.getSuccessors(i)) {
-          tmp_res_delay_succ = tmp_res_delay_succ && _g._delay[tmp_v];
-        }
-
-        _g._latest[i] = _result[i] && (_g._used[i] || (!tmp_res_delay_succ));
-      }
-    }
-
-  private:
-    FlowGraph &_g;
-    int _size;
-    int *_result;
-  };
-
-  class Isolated {
-  public:
-    Isolated(FlowGraph &g) : _g(g), _size(g._size), _result(g._isolated) {}
-
-    ~Isolated() {}
-
-    void compute() {
-      for (int i = 0; i < _size - 1; ++i) {
-        _result[i] = 1;
-      }
-      // It should be True at the exit node to have the greatest solution!
-      _result[_size - 1] = 1;
-
-      std::queue<int> worklist{};
-      for (int i = 0; i < _size - 1; ++i) {
-        worklist.push(i);
-      }
-
-      while (!worklist.empty()) {
-        int tmp_u = worklist.front();
-        worklist.pop();
-        int tmp_res_u = 1;
-
-        for (auto tmp_v : _g.getSuccessors(tmp_u)) {
-          int tmp_res_v =
-              _g._latest[tmp_v] || ((!_g._used[tmp_v]) && _result[tmp_v]);
-          tmp_res_u = tmp_res_u && tmp_res_v;
-        }
-
-        if (tmp_res_u != _result[tmp_u]) {
-          std::cout << "[Update] Isolated[" << tmp_u
-                    << "] := " << ((tmp_res_u == 1) ? "True" : "False") << "\n";
-          _result[tmp_u] = tmp_res_u;
-          for (auto tmp_u_prec : _g.getPrecessors(tmp_u)) {
-            worklist.push(tmp_u_prec);
-            // std::cout << "[Debug] Add to worklist: " << tmp_u_prec << "\n";
-          }
-        }
-      }
-    }
-
-  private:
-    FlowGraph &_g;
-    int _size;
-    int *_result;
-  };
-
-private:
-  int _size;
-  int *_edges;
-  int *_used;
-  int *_killed;
-  int *_downsafety;
-  int *_earliestness;
-  int *_delay;
-  int *_latest;
-  int *_isolated;
-
-  void drawNodesBCM(std::ofstream &dotOuts, int i, int isUsed, int isKilled,
-                    int isPlaced, int isSafety, int isEarliest) {
-    dotOuts << "\t"
-            << "BB" << i << " [label=\"";
-
-    if (isPlaced && isSafety && isEarliest) {
-      dotOuts << "h := a + b;\\n";
-    }
-    if (isUsed) {
-      if (isPlaced) {
-        dotOuts << "... := h;\\n";
-      } else {
-        dotOuts << "... := a + b;\\n";
-      }
-    }
-    if (isKilled) {
-      dotOuts << "a := c;\\n";
-    }
-    dotOuts << "\"; "
-            << "xlabel=\"BB" << i << ":\";";
-    if (isPlaced && isSafety) {
-      dotOuts << " color=Turquoise;";
-    }
-    if (isPlaced && isEarliest) {
-      dotOuts << " style=filled;";
-    }
-    dotOuts << "];\n";
-  }
-
-  void drawNodesALCM(std::ofstream &dotOuts, int i, int isUsed, int isKilled,
-                     int isPlaced, int isDelay, int isLatest) {
-    dotOuts << "\t"
-            << "BB" << i << " [label=\"";
-
-    if (isPlaced && isLatest) {
-      dotOuts << "h := a + b;\\n";
-    }
-    if (isUsed) {
-      if (isPlaced) {
-        dotOuts << "... := h;\\n";
-      } else {
-        dotOuts << "... := a + b;\\n";
-      }
-    }
-    if (isKilled) {
-      dotOuts << "a := c;\\n";
-    }
-    dotOuts << "\"; "
-            << "xlabel=\"BB" << i << ":\";";
-    if (isPlaced && isDelay) {
-      dotOuts << " style=filled;";
-    }
-    if (isPlaced && isLatest) {
-      dotOuts << " color=yellow;";
-    }
-    dotOuts << "];\n";
-  }
-
-  void drawNodesLCM(std::ofstream &dotOuts, int i, int isKilled, int isOCP,
-                    int isIC, int isRO) {
-    dotOuts << "\t"
-            << "BB" << i << " [label=\"";
-
-    if (isOCP) {
-      dotOuts << "h := a + b;\\n";
-    } else if (isIC) {
-      dotOuts << "... := a + b;\\n";
-    }
-    if (isRO) {
-      dotOuts << "... := h;\\n";
-    }
-    if (isKilled) {
-      dotOuts << "a := c;\\n";
-    }
-    dotOuts << "\"; "
-            << "xlabel=\"BB" << i << ":\";";
-
-    if (isOCP && !isRO) {
-      dotOuts << " fillcolor=yellow; style=filled;";
-    } else if (isIC) {
-      dotOuts << " fillcolor=pink; style=filled;";
-    }
-    if (isRO) {
-      if (!isOCP) {
-        dotOuts << " fillcolor=darkseagreen3; style=filled;";
-      } else {
-        dotOuts << " fillcolor=\"yellow:darkseagreen3\"; style=filled;";
-      }
-    }
-
-    dotOuts << "];\n";
-  }
-
-  void drawEdges(std::ofstream &dotOuts, int i, int j) {
-    dotOuts << "\t"
-            << "BB" << i << "->BB" << j << ";\n";
-  }
-};
+#include "batch_driver.h"
+#include "bit_flow_graph.h"
+#include "cfg_loader.h"
+#include "dominators.h"
+#include "evaluation_sim.h"
+#include "flow_graph.h"
+#include "lifetime_report.h"
+#include "speculative_pre.h"
+#include "ssa_pre.h"
 
 // Original Paper Demo
 void test1() {
@@ -910,10 +433,714 @@ void test10() {
   g.drawLCM("demo10_lcm.dot");
 }
 
-int main() {
-  std::cout << "Lazy-Code-Motion implemented By zhaosiying12138@LiuYueCity "
-               "Academy of Sciences!\n";
-  test10();
+// Bit-vector mode: test10's CFG with two expressions solved together.
+// Expression 0 is the a + b of test10, expression 1 is c + d.
+void test11() {
+  BitFlowGraph g(19, 2);
 
-  return 0;
-}
\ No newline at end of file
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 18);
+  g.addEdge(1, 11);
+  g.addEdge(11, 3);
+  g.addEdge(18, 3);
+  g.addEdge(3, 12);
+  g.addEdge(12, 5);
+  g.addEdge(3, 13);
+  g.addEdge(13, 6);
+  g.addEdge(3, 14);
+  g.addEdge(14, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 15);
+  g.addEdge(15, 8);
+  g.addEdge(6, 16);
+  g.addEdge(16, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 17);
+  g.addEdge(17, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 19);
+  g.addEdge(19, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 20); // exit node 's edges
+
+  g.setUsed(2, 0);
+  g.setUsed(18, 0);
+  g.setUsed(4, 0);
+  g.setUsed(7, 0);
+  g.setUsed(8, 0);
+  g.setUsed(9, 0);
+  g.setKilled(2, 0);
+  g.setKilled(8, 0);
+
+  g.setUsed(4, 1);
+  g.setUsed(7, 1);
+  g.setUsed(10, 1);
+  g.setKilled(6, 1);
+
+  std::cout << "Step 1: Compute Down-Safety\n";
+  BitFlowGraph::DownSafety d_safe{g};
+  d_safe.compute();
+
+  std::cout << "Step 2: Compute Earliestness\n";
+  BitFlowGraph::Earliestness early{g};
+  early.compute();
+  g.getPlacementBCM();
+
+  std::cout << "\nStep 3: Compute Delay & Latest\n";
+  BitFlowGraph::DelayLatest delay{g};
+  delay.compute();
+
+  std::cout << "Step 4: Compute Isolated\n";
+  BitFlowGraph::Isolated isolated{g};
+  isolated.compute();
+
+  std::cout << "\n";
+  g.getPlacementLCM();
+}
+
+// Original Paper 94 Demo before preprocessing: critical edges are split and
+// the graph is t-refined automatically instead of by hand as in test10.
+void test12() {
+  FlowGraph g(10);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(1, 3);
+  g.addEdge(2, 3);
+  g.addEdge(3, 5);
+  g.addEdge(3, 6);
+  g.addEdge(3, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 8);
+  g.addEdge(6, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 11); // exit node 's edges
+
+  g.setUsed(2);
+  g.setUsed(4);
+  g.setUsed(7);
+  g.setUsed(8);
+  g.setUsed(9);
+  g.setKilled(2);
+  g.setKilled(8);
+
+  std::cout << "Preprocess 1: Split Critical Edges\n";
+  std::cout << "[Inserted Nodes]: " << g.splitCriticalEdges() << "\n";
+  g.drawBCM("demo12_split_critical_edge.dot", 0);
+
+  std::cout << "\nPreprocess 2: Make FlowGraph t-Refined\n";
+  std::cout << "[Inserted Nodes]: " << g.makeTRefined() << "\n";
+  g.drawBCM("demo12_t_refined_cfg.dot", 0);
+
+  std::cout << "\nStep 1: Compute Down-Safety\n";
+  FlowGraph::DownSafety d_safe{g};
+  d_safe.compute();
+  std::cout << "[D-Safety Result]: ";
+  g.printVector(g.getDownSafety());
+
+  std::cout << "\nStep 2: Compute Earliestness\n";
+  FlowGraph::Earliestness early{g};
+  early.compute();
+  std::cout << "[Earliestness Result]: ";
+  g.printVector(g.getEarliestness());
+
+  g.getPlacementBCM();
+
+  std::cout << "\nStep 3: Compute Delay & Latest\n";
+  FlowGraph::DelayLatest delay{g};
+  delay.compute();
+  std::cout << "[Delay Result]: ";
+  g.printVector(g.getDelay());
+  std::cout << "[Latest Result]: ";
+  g.printVector(g.getLatest());
+
+  std::cout << "\nStep 4: Compute Isolated\n";
+  FlowGraph::Isolated isolated{g};
+  isolated.compute();
+  std::cout << "[Isolated Result]: ";
+  g.printVector(g.getIsolated());
+
+  std::cout << "\n";
+  g.getPlacementLCM();
+  g.drawLCM("demo12_lcm.dot");
+  g.writeResults("demo12_lcm.ndjson");
+
+  std::cout << "\n[Pass Stats]: ";
+  g.writePassStats(std::cout);
+}
+
+// Original Paper 94 Demo with real basic blocks: block 2 is
+// "x := a + b; a := c; y := a + b" and block 8 "x := a + b; a := c", so
+// only critical edges are split and no t-refinement is needed. Placements
+// are reported at instruction positions. A second graph has a block that
+// kills before it uses: BB1 "x := a + b", BB2 "a := c; y := a + b", BB3
+// "z := a + b". BB3 reads the value BB2 recomputes, never the one of BB1,
+// so x := a + b stays in place as an isolated computation.
+void test13() {
+  using Instr = FlowGraph::Instr;
+  FlowGraph g(10);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(1, 3);
+  g.addEdge(2, 3);
+  g.addEdge(3, 5);
+  g.addEdge(3, 6);
+  g.addEdge(3, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 8);
+  g.addEdge(6, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 11); // exit node 's edges
+
+  g.addInstruction(2, Instr::Use);
+  g.addInstruction(2, Instr::Kill);
+  g.addInstruction(2, Instr::Use);
+  g.addInstruction(4, Instr::Other);
+  g.addInstruction(4, Instr::Use);
+  g.addInstruction(7, Instr::Use);
+  g.addInstruction(7, Instr::Use);
+  g.addInstruction(8, Instr::Use);
+  g.addInstruction(8, Instr::Kill);
+  g.addInstruction(9, Instr::Use);
+  g.addInstruction(9, Instr::Other);
+
+  std::cout << "Preprocess: Split Critical Edges\n";
+  std::cout << "[Inserted Nodes]: " << g.splitCriticalEdges() << "\n";
+
+  FlowGraph::DownSafety<NoTrace> d_safe{g};
+  d_safe.compute();
+  FlowGraph::Earliestness<NoTrace> early{g};
+  early.compute();
+  FlowGraph::DelayLatest<NoTrace> delay{g};
+  delay.compute();
+  FlowGraph::Isolated<NoTrace> isolated{g};
+  isolated.compute();
+
+  std::cout << "\n";
+  g.getPlacementLCM();
+  std::cout << "\n";
+  g.getPlacementInstrLCM();
+
+  FlowGraph chain(3);
+
+  chain.addEdge(0, 1); // entry node 's edges
+  chain.addEdge(1, 2);
+  chain.addEdge(2, 3);
+  chain.addEdge(3, 4); // exit node 's edges
+
+  chain.addInstruction(1, Instr::Use);
+  chain.addInstruction(2, Instr::Kill);
+  chain.addInstruction(2, Instr::Use);
+  chain.addInstruction(3, Instr::Use);
+
+  FlowGraph::Incremental<NoTrace> lcm{chain};
+  lcm.compute();
+  std::cout << "\n";
+  chain.getPlacementInstrLCM();
+}
+
+// Incremental re-analysis on the graph of test10: the solution is brought
+// up to date after BB4 stops using a + b and BB11 starts using it.
+void test14() {
+  FlowGraph g(19);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 18);
+  g.addEdge(1, 11);
+  g.addEdge(11, 3);
+  g.addEdge(18, 3);
+  g.addEdge(3, 12);
+  g.addEdge(12, 5);
+  g.addEdge(3, 13);
+  g.addEdge(13, 6);
+  g.addEdge(3, 14);
+  g.addEdge(14, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 15);
+  g.addEdge(15, 8);
+  g.addEdge(6, 16);
+  g.addEdge(16, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 17);
+  g.addEdge(17, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 19);
+  g.addEdge(19, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 20); // exit node 's edges
+
+  g.setUsed(2);
+  g.setUsed(18);
+  g.setUsed(4);
+  g.setUsed(7);
+  g.setUsed(8);
+  g.setUsed(9);
+  g.setKilled(2);
+  g.setKilled(8);
+
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+  std::cout << "[Full Solve Visits]: " << lcm.getVisitCount() << "\n";
+  g.getPlacementLCM();
+
+  g.setUsed(4, false);
+  g.setUsed(11);
+  lcm.update();
+  std::cout << "\n[Incremental Update Visits]: " << lcm.getVisitCount()
+            << "\n";
+  g.getPlacementLCM();
+}
+
+// Dynamic evaluations of a + b on the graph of test10 under a profile:
+// BB3 branches 50/30/20, the loop 4-5 repeats with probability 0.9 and the
+// self-loop 6-16 with 0.8.
+void test15() {
+  FlowGraph g(19);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 18);
+  g.addEdge(1, 11);
+  g.addEdge(11, 3);
+  g.addEdge(18, 3);
+  g.addEdge(3, 12);
+  g.addEdge(12, 5);
+  g.addEdge(3, 13);
+  g.addEdge(13, 6);
+  g.addEdge(3, 14);
+  g.addEdge(14, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 15);
+  g.addEdge(15, 8);
+  g.addEdge(6, 16);
+  g.addEdge(16, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 17);
+  g.addEdge(17, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 19);
+  g.addEdge(19, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 20); // exit node 's edges
+
+  g.setUsed(2);
+  g.setUsed(18);
+  g.setUsed(4);
+  g.setUsed(7);
+  g.setUsed(8);
+  g.setUsed(9);
+  g.setKilled(2);
+  g.setKilled(8);
+
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+
+  EvaluationSimulator sim(g);
+  sim.setEdgeWeight(3, 12, 0.5);
+  sim.setEdgeWeight(3, 13, 0.3);
+  sim.setEdgeWeight(3, 14, 0.2);
+  sim.setEdgeWeight(5, 4, 0.9);
+  sim.setEdgeWeight(5, 15, 0.1);
+  sim.setEdgeWeight(6, 16, 0.8);
+  sim.setEdgeWeight(6, 7, 0.1);
+  sim.setEdgeWeight(6, 17, 0.1);
+
+  EvaluationSimulator::Counts expected = sim.expected();
+  std::cout << "[Expected Evaluations]: original " << expected.original
+            << ", BCM " << expected.bcm << ", LCM " << expected.lcm << "\n";
+  EvaluationSimulator::Counts walked = sim.monteCarlo(100000);
+  std::cout << "[Monte-Carlo Evaluations]: original " << walked.original
+            << ", BCM " << walked.bcm << ", LCM " << walked.lcm << "\n";
+}
+
+// Live ranges of h under BCM, ALCM and LCM, for the paper graph and for the
+// two-expression graph of test11.
+void test16() {
+  FlowGraph g(19);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 18);
+  g.addEdge(1, 11);
+  g.addEdge(11, 3);
+  g.addEdge(18, 3);
+  g.addEdge(3, 12);
+  g.addEdge(12, 5);
+  g.addEdge(3, 13);
+  g.addEdge(13, 6);
+  g.addEdge(3, 14);
+  g.addEdge(14, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 15);
+  g.addEdge(15, 8);
+  g.addEdge(6, 16);
+  g.addEdge(16, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 17);
+  g.addEdge(17, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 19);
+  g.addEdge(19, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 20); // exit node 's edges
+
+  g.setUsed(2);
+  g.setUsed(18);
+  g.setUsed(4);
+  g.setUsed(7);
+  g.setUsed(8);
+  g.setUsed(9);
+  g.setKilled(2);
+  g.setKilled(8);
+
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+
+  LifetimeReport report(g);
+  report.printRanges();
+  report.print();
+
+  BitFlowGraph bits(19, 2);
+
+  bits.addEdge(0, 1); // entry node 's edges
+  bits.addEdge(1, 2);
+  bits.addEdge(2, 18);
+  bits.addEdge(1, 11);
+  bits.addEdge(11, 3);
+  bits.addEdge(18, 3);
+  bits.addEdge(3, 12);
+  bits.addEdge(12, 5);
+  bits.addEdge(3, 13);
+  bits.addEdge(13, 6);
+  bits.addEdge(3, 14);
+  bits.addEdge(14, 10);
+  bits.addEdge(4, 5);
+  bits.addEdge(5, 4);
+  bits.addEdge(5, 15);
+  bits.addEdge(15, 8);
+  bits.addEdge(6, 16);
+  bits.addEdge(16, 6);
+  bits.addEdge(6, 7);
+  bits.addEdge(6, 17);
+  bits.addEdge(17, 9);
+  bits.addEdge(7, 8);
+  bits.addEdge(8, 19);
+  bits.addEdge(19, 9);
+  bits.addEdge(9, 10);
+  bits.addEdge(10, 20); // exit node 's edges
+
+  bits.setUsed(2, 0);
+  bits.setUsed(18, 0);
+  bits.setUsed(4, 0);
+  bits.setUsed(7, 0);
+  bits.setUsed(8, 0);
+  bits.setUsed(9, 0);
+  bits.setKilled(2, 0);
+  bits.setKilled(8, 0);
+
+  bits.setUsed(4, 1);
+  bits.setUsed(7, 1);
+  bits.setUsed(10, 1);
+  bits.setKilled(6, 1);
+
+  BitFlowGraph::DownSafety d_safe{bits};
+  d_safe.compute();
+  BitFlowGraph::Earliestness early{bits};
+  early.compute();
+  BitFlowGraph::DelayLatest delay{bits};
+  delay.compute();
+  BitFlowGraph::Isolated isolated{bits};
+  isolated.compute();
+
+  std::cout << "\n[Two Expressions]:\n";
+  LifetimeReport(bits).print();
+}
+
+// Speculative PRE on the paper graph with the profile of test15: a + b is
+// hoisted onto edge 11 -> 3, above the branch at BB3, although the path
+// through BB14 (20% of the runs from BB3) never uses it.
+void test17() {
+  FlowGraph g(19);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 18);
+  g.addEdge(1, 11);
+  g.addEdge(11, 3);
+  g.addEdge(18, 3);
+  g.addEdge(3, 12);
+  g.addEdge(12, 5);
+  g.addEdge(3, 13);
+  g.addEdge(13, 6);
+  g.addEdge(3, 14);
+  g.addEdge(14, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 15);
+  g.addEdge(15, 8);
+  g.addEdge(6, 16);
+  g.addEdge(16, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 17);
+  g.addEdge(17, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 19);
+  g.addEdge(19, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 20); // exit node 's edges
+
+  g.setUsed(2);
+  g.setUsed(18);
+  g.setUsed(4);
+  g.setUsed(7);
+  g.setUsed(8);
+  g.setUsed(9);
+  g.setKilled(2);
+  g.setKilled(8);
+
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+
+  EvaluationSimulator sim(g);
+  sim.setEdgeWeight(3, 12, 0.5);
+  sim.setEdgeWeight(3, 13, 0.3);
+  sim.setEdgeWeight(3, 14, 0.2);
+  sim.setEdgeWeight(5, 4, 0.9);
+  sim.setEdgeWeight(5, 15, 0.1);
+  sim.setEdgeWeight(6, 16, 0.8);
+  sim.setEdgeWeight(6, 7, 0.1);
+  sim.setEdgeWeight(6, 17, 0.1);
+
+  SpeculativePRE mc(g, sim);
+  mc.getPlacement();
+  mc.report();
+}
+
+// Lazy Strength Reduction on an induction variable loop: BB1 sets a := c,
+// BB2 and the loop latch BB4 step a := a + c, and BB3 computes a * b every
+// iteration. Plain LCM multiplies in the loop; strength reduction computes
+// h once after BB2 and keeps it current with an addition in BB4.
+void test18() {
+  FlowGraph g(5);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 3);
+  g.addEdge(3, 4);
+  g.addEdge(4, 3);
+  g.addEdge(3, 5);
+  g.addEdge(5, 6); // exit node 's edges
+
+  g.setUsed(3);
+  g.setKilled(1);
+  g.setInjured(2);
+  g.setInjured(4);
+
+  std::cout << "Without Strength Reduction:\n";
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+  g.getPlacementLCM();
+
+  std::cout << "\nWith Lazy Strength Reduction:\n";
+  g.setStrengthReduction(true);
+  g.makeTRefined();
+  FlowGraph::Incremental<NoTrace> lsr{g};
+  lsr.compute();
+  FlowGraph::StrengthReduction<NoTrace> sr{g};
+  sr.compute();
+  g.getPlacementLCM();
+  g.getPlacementLSR();
+  g.drawLCM("demo18_lsr.dot");
+}
+
+// Partial dead code elimination: x := a + b in BB1 is only read on the
+// BB2 branch, so it sinks into BB2; the copy on the BB3 branch is dead and
+// goes away. BB4 computes a + b, which was fully redundant before and
+// becomes partially redundant, so LCM adds an insertion on the BB3 path.
+void test19() {
+  using Instr = FlowGraph::Instr;
+  FlowGraph g(4);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(1, 3);
+  g.addEdge(2, 4);
+  g.addEdge(3, 4);
+  g.addEdge(4, 5); // exit node 's edges
+
+  g.addInstruction(1, Instr::Assign);
+  g.addInstruction(2, Instr::UseX);
+  g.addInstruction(3, Instr::Other);
+  g.addInstruction(4, Instr::Use);
+
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+  g.getPlacementInstrLCM();
+
+  std::cout << "\n";
+  FlowGraph::PartialDeadCode<NoTrace> pdce{g};
+  pdce.apply();
+  pdce.getPlacement();
+  lcm.update();
+  std::cout << "[Further Rounds]: " << pdce.optimize(lcm) << "\n";
+  g.getPlacementInstrLCM();
+  g.drawPDCE("demo19_pdce.dot");
+}
+
+// The sparse SSAPRE engine on the t-refined graph of test10: Phis at the
+// iterated dominance frontier of the used and killed blocks, insertions on
+// the edges into them, and the same placement as the dense analyses.
+void test20() {
+  FlowGraph g(19);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 18);
+  g.addEdge(1, 11);
+  g.addEdge(11, 3);
+  g.addEdge(18, 3);
+  g.addEdge(3, 12);
+  g.addEdge(12, 5);
+  g.addEdge(3, 13);
+  g.addEdge(13, 6);
+  g.addEdge(3, 14);
+  g.addEdge(14, 10);
+  g.addEdge(4, 5);
+  g.addEdge(5, 4);
+  g.addEdge(5, 15);
+  g.addEdge(15, 8);
+  g.addEdge(6, 16);
+  g.addEdge(16, 6);
+  g.addEdge(6, 7);
+  g.addEdge(6, 17);
+  g.addEdge(17, 9);
+  g.addEdge(7, 8);
+  g.addEdge(8, 19);
+  g.addEdge(19, 9);
+  g.addEdge(9, 10);
+  g.addEdge(10, 20); // exit node 's edges
+
+  g.setUsed(2);
+  g.setUsed(18);
+  g.setUsed(4);
+  g.setUsed(7);
+  g.setUsed(8);
+  g.setUsed(9);
+  g.setKilled(2);
+  g.setKilled(8);
+
+  g.makeTRefined();
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+  g.getPlacementLCM();
+
+  std::cout << "\n";
+  DominatorTree dom{g};
+  SSAPRE pre{g, dom};
+  pre.compute();
+  pre.getPlacement();
+  std::cout << "[Mismatches against LCM]: " << pre.crossCheck() << "\n";
+}
+
+// A loop header as the first block: BB1 computes a + b and BB2 jumps back
+// to it with probability 0.1. The entry is no insertion point, so the edge
+// 0 -> 1 gets a node of its own by t-refinement and a + b is evaluated
+// once per run instead of once per iteration.
+void test21() {
+  FlowGraph g(3);
+
+  g.addEdge(0, 1); // entry node 's edges
+  g.addEdge(1, 2);
+  g.addEdge(2, 1);
+  g.addEdge(2, 3);
+  g.addEdge(3, 4); // exit node 's edges
+
+  g.setUsed(1);
+
+  std::cout << "[Inserted Nodes]: " << g.makeTRefined() << "\n";
+  FlowGraph::Incremental<NoTrace> lcm{g};
+  lcm.compute();
+  g.getPlacementLCM();
+
+  EvaluationSimulator sim(g);
+  sim.setEdgeWeight(2, 1, 0.1);
+  sim.setEdgeWeight(2, 3, 0.9);
+  EvaluationSimulator::Counts expected = sim.expected();
+  std::cout << "[Expected Evaluations]: original " << expected.original
+            << ", BCM " << expected.bcm << ", LCM " << expected.lcm << "\n";
+}
+
+// Run the whole pipeline on CFGs loaded from line-format or DOT files,
+// spread over `threads` workers, and print the placements in input order.
+void runFiles(const std::vector<std::string> &files, int threads,
+              const std::string &statsPath) {
+  BatchDriver driver(threads);
+  std::vector<BatchResult> results = driver.runFiles(files);
+  if (!statsPath.empty()) {
+    std::ofstream stats(statsPath);
+    for (const BatchResult &res : results) {
+      stats << res.stats;
+    }
+  }
+  for (const BatchResult &res : results) {
+    std::cout << "\n[" << res.name << "] " << res.seconds * 1000 << " ms\n";
+    if (!res.error.empty()) {
+      std::cout << "[Error]: " << res.error << "\n";
+    }
+    std::cout << res.placement;
+  }
+  std::cout << "\n[Total]: " << results.size() << " graphs, "
+            << driver.getTotalSeconds() * 1000 << " ms on " << threads
+            << " threads\n";
+}
+
+int main(int argc, char **argv) {
+  std::cout << "Lazy-Code-Motion implemented By zhaosiying12138@LiuYueCity "
+               "Academy of Sciences!\n";
+  if (argc > 1) {
+    int threads = 1;
+    std::string statsPath;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "-j") {
+        std::string_view value = i + 1 < argc ? argv[++i] : "";
+        auto [ptr, ec] = std::from_chars(
+            value.data(), value.data() + value.size(), threads);
+        if (ec != std::errc() || ptr != value.data() + value.size() ||
+            threads <= 0) {
+          std::cerr << "usage: " << argv[0]
+                    << " [-j THREADS] [--stats FILE] CFG...\n"
+                       "  THREADS must be a positive integer\n";
+          return 1;
+        }
+      } else if (arg == "--stats" && i + 1 < argc) {
+        statsPath = argv[++i];
+      } else {
+        files.push_back(arg);
+      }
+    }
+    runFiles(files, threads, statsPath);
+    return 0;
+  }
+  test10();
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Allocator that starts every block on a cache line, so data split between
+// threads at cache-line boundaries is never falsely shared.
+template <typename T> struct CacheAlignedAllocator {
+  using value_type = T;
+
+  static constexpr std::align_val_t kAlign{64};
+
+  CacheAlignedAllocator() = default;
+
+  template <typename U>
+  CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(::operator new(n * sizeof(T), kAlign));
+  }
+
+  void deallocate(T *p, std::size_t) { ::operator delete(p, kAlign); }
+
+  template <typename U>
+  bool operator==(const CacheAlignedAllocator<U> &) const {
+    return true;
+  }
+};
+
+// Run task(i) for every i in [0, count) on `threads` threads and wait for
+// all of them. Each worker owns a deque seeded with a contiguous block of
+// indices; it pops from the back of its own deque and, once that is empty,
+// steals from the front of the others, so uneven task costs (one huge
+// function among many small ones) still keep every core busy.
+template <typename Task>
+void parallelFor(std::size_t count, int threads, Task task) {
+  threads = std::max(1, std::min<int>(threads, count));
+  if (threads == 1) {
+    for (std::size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  struct alignas(64) WorkQueue {
+    std::mutex lock;
+    std::deque<std::size_t> items;
+  };
+  std::vector<WorkQueue> queues(threads);
+  for (std::size_t i = 0; i < count; ++i) {
+    queues[i * threads / count].items.push_back(i);
+  }
+
+  auto worker = [&](int self) {
+    while (true) {
+      std::size_t item = 0;
+      bool found = false;
+      {
+        std::lock_guard<std::mutex> guard(queues[self].lock);
+        if (!queues[self].items.empty()) {
+          item = queues[self].items.back();
+          queues[self].items.pop_back();
+          found = true;
+        }
+      }
+      for (int k = 1; k < threads && !found; ++k) {
+        WorkQueue &victim = queues[(self + k) % threads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.items.empty()) {
+          item = victim.items.front();
+          victim.items.pop_front();
+          found = true;
+        }
+      }
+      // No task ever spawns new ones, so empty deques everywhere means done.
+      if (!found) {
+        return;
+      }
+      task(item);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < threads; ++t) {
+    pool.emplace_back(worker, t);
+  }
+  worker(0);
+  for (auto &thread : pool) {
+    thread.join();
+  }
+}
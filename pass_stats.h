@@ -0,0 +1,123 @@
+#pragma once
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Process memory high-water mark in KiB.
+inline long peakRSSKb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Counters of one run of a pipeline pass. Fields a pass has no use for stay
+// 0, e.g. pushes for the single-pass ones.
+struct PassStats {
+  std::string pass;
+  long visits = 0;     // node evaluations (elimination: fold/recover steps)
+  long pushes = 0;     // worklist pushes, including duplicates
+  long changes = 0;    // lattice value changes
+  long iterations = 0; // sweeps in worklist order until the fixpoint
+  double seconds = 0;
+  long peakRssKb = 0; // process high-water mark when the pass ended
+};
+
+// The PassStats of one graph: the latest run of every pass, in the order
+// the passes first ran. Passes on different threads may record at once.
+class PassStatsLog {
+public:
+  void record(PassStats stats) {
+    std::lock_guard<std::mutex> guard(*_lock);
+    for (PassStats &entry : _stats) {
+      if (entry.pass == stats.pass) {
+        entry = std::move(stats);
+        return;
+      }
+    }
+    _stats.push_back(std::move(stats));
+  }
+
+  std::optional<PassStats> find(std::string_view pass) const {
+    std::lock_guard<std::mutex> guard(*_lock);
+    for (const PassStats &entry : _stats) {
+      if (entry.pass == pass) {
+        return entry;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::vector<PassStats> getAll() const {
+    std::lock_guard<std::mutex> guard(*_lock);
+    return _stats;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> guard(*_lock);
+    _stats.clear();
+  }
+
+  // One line of JSON, labelled with graph if it is not empty:
+  // {"graph":"a.cfg","passes":[{"pass":"DownSafety","visits":1003,
+  //  "pushes":1210,"changes":12,"iterations":2,"seconds":1.2e-05,
+  //  "peak_rss_kb":3528},...]}
+  void writeJSON(std::ostream &outs, std::string_view graph = {}) const {
+    outs << "{";
+    if (!graph.empty()) {
+      outs << "\"graph\":\"" << graph << "\",";
+    }
+    outs << "\"passes\":[";
+    const char *sep = "";
+    for (const PassStats &s : getAll()) {
+      outs << sep << "{\"pass\":\"" << s.pass << "\",\"visits\":" << s.visits
+           << ",\"pushes\":" << s.pushes << ",\"changes\":" << s.changes
+           << ",\"iterations\":" << s.iterations
+           << ",\"seconds\":" << s.seconds
+           << ",\"peak_rss_kb\":" << s.peakRssKb << "}";
+      sep = ",";
+    }
+    outs << "]}\n";
+  }
+
+private:
+  // Behind a pointer so that graphs stay movable.
+  std::unique_ptr<std::mutex> _lock = std::make_unique<std::mutex>();
+  std::vector<PassStats> _stats;
+};
+
+// Times a pass from construction to destruction and then records stats()
+// in the log, so early returns are covered too.
+class PassRecorder {
+public:
+  PassRecorder(PassStatsLog &log, std::string pass)
+      : _log(log), _start(std::chrono::steady_clock::now()) {
+    _stats.pass = std::move(pass);
+  }
+
+  PassRecorder(const PassRecorder &) = delete;
+  PassRecorder &operator=(const PassRecorder &) = delete;
+
+  ~PassRecorder() {
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - _start;
+    _stats.seconds = elapsed.count();
+    _stats.peakRssKb = peakRSSKb();
+    _log.record(std::move(_stats));
+  }
+
+  PassStats &stats() { return _stats; }
+
+private:
+  PassStatsLog &_log;
+  std::chrono::steady_clock::time_point _start;
+  PassStats _stats;
+};
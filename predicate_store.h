@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "parallel.h"
+
+// The boolean per-node facts of a FlowGraph: the local predicates and the
+// results of the LCM analyses, of Lazy Strength Reduction and of partial
+// dead code elimination.
+enum class Predicate {
+  Used,
+  Killed,
+  Comp,
+  DownSafety,
+  UpSafety,
+  Earliestness,
+  Delay,
+  Latest,
+  Isolated,
+  Injured,
+  Kills,
+  Live,
+  Update,
+  Sinkable,
+  XLive
+};
+
+// Read-only view of one predicate, indexed by node.
+class PredicateView {
+public:
+  PredicateView(const std::uint16_t *flags, std::uint16_t mask, int size)
+      : _flags(flags), _mask(mask), _size(size) {}
+
+  int operator[](int u) const { return (_flags[u] & _mask) != 0; }
+
+  int size() const { return _size; }
+
+private:
+  const std::uint16_t *_flags;
+  std::uint16_t _mask;
+  int _size;
+};
+
+// Writable view of one predicate, used by the solvers like an int array.
+class PredicateColumn {
+public:
+  class Ref {
+  public:
+    Ref(std::uint16_t &flags, std::uint16_t mask)
+        : _flags(flags), _mask(mask) {}
+
+    operator int() const { return (_flags & _mask) != 0; }
+
+    Ref &operator=(int value) {
+      _flags = value ? (_flags | _mask) : (_flags & ~_mask);
+      return *this;
+    }
+
+    Ref &operator=(const Ref &other) { return *this = int(other); }
+
+  private:
+    std::uint16_t &_flags;
+    std::uint16_t _mask;
+  };
+
+  PredicateColumn() = default;
+
+  PredicateColumn(std::uint16_t *flags, std::uint16_t mask, int size)
+      : _flags(flags), _mask(mask), _size(size) {}
+
+  Ref operator[](int u) const { return Ref(_flags[u], _mask); }
+
+  operator PredicateView() const { return {_flags, _mask, _size}; }
+
+private:
+  std::uint16_t *_flags = nullptr;
+  std::uint16_t _mask = 0;
+  int _size = 0;
+};
+
+// Bit-packed store for all predicates: one 16-bit word per node with one bit
+// per Predicate, in a single cache-aligned allocation. A node's whole state
+// is one load (flags()), and the store is 30x smaller than one int array per
+// predicate. Move-only; columns and views stay valid across moves but not
+// across grow().
+class PredicateStore {
+public:
+  explicit PredicateStore(int size) : _flags(size, 0) {}
+
+  PredicateStore(const PredicateStore &) = delete;
+  PredicateStore &operator=(const PredicateStore &) = delete;
+  PredicateStore(PredicateStore &&) = default;
+  PredicateStore &operator=(PredicateStore &&) = default;
+
+  static constexpr std::uint16_t mask(Predicate p) {
+    return std::uint16_t(1u << static_cast<int>(p));
+  }
+
+  std::uint16_t flags(int u) const { return _flags[u]; }
+
+  PredicateColumn column(Predicate p) {
+    return {_flags.data(), mask(p), size()};
+  }
+
+  PredicateView view(Predicate p) const {
+    return {_flags.data(), mask(p), size()};
+  }
+
+  int size() const { return static_cast<int>(_flags.size()); }
+
+  // Make room for count synthetic nodes inserted in front of the exit node.
+  // They start out with every predicate false.
+  void grow(int count) { _flags.insert(_flags.end() - 1, count, 0); }
+
+private:
+  std::vector<std::uint16_t, CacheAlignedAllocator<std::uint16_t>> _flags;
+};
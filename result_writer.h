@@ -0,0 +1,57 @@
+#pragma once
+
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Output file for the DOT and NDJSON result writers. Pieces are appended to
+// an in-memory buffer and reach the file in large blocks, so a graph with
+// millions of nodes costs a few hundred write calls instead of one per
+// token. Every writer owns its buffer, so any number of them may be open
+// at once on the same thread.
+class BufferedWriter {
+public:
+  BufferedWriter(const std::string &Filepath, std::size_t capacity = 1 << 20)
+      : _file(Filepath, std::ios::out | std::ios::trunc | std::ios::binary),
+        _capacity(capacity) {
+    if (!_file) {
+      throw std::runtime_error(Filepath + ": cannot open");
+    }
+    _buffer.reserve(capacity);
+  }
+
+  ~BufferedWriter() { flush(); }
+
+  BufferedWriter &operator<<(std::string_view text) {
+    if (_buffer.size() + text.size() > _capacity) {
+      flush();
+    }
+    _buffer.append(text);
+    return *this;
+  }
+
+  BufferedWriter &operator<<(char c) {
+    return *this << std::string_view(&c, 1);
+  }
+
+  BufferedWriter &operator<<(long value) {
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    return *this << std::string_view(digits, end - digits);
+  }
+
+  BufferedWriter &operator<<(int value) { return *this << long(value); }
+
+  void flush() {
+    _file.write(_buffer.data(), _buffer.size());
+    _file.flush();
+    _buffer.clear();
+  }
+
+private:
+  std::ofstream _file;
+  std::string _buffer;
+  std::size_t _capacity;
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "evaluation_sim.h"
+#include "flow_graph.h"
+
+// Profile-guided speculative PRE in the style of MC-PRE (Cai and Xue): the
+// insertion points of a + b are a minimum cut of a flow network whose
+// capacities are execution frequencies, so h := a + b may be hoisted onto
+// paths that never use it when that is cheaper on the profile. LCM is
+// bound by down-safety and cannot do that; its placement is one of the
+// cuts, so this one never evaluates a + b more often.
+//
+// Every block v has an entry point in(v) and an exit point out(v). The
+// network connects
+//
+//   source -> out(0) and out(k) for blocks k that kill a + b without
+//             recomputing it (the value is missing there),
+//   out(u) -> in(v) for every CFG edge, with capacity freq(u -> v): cut,
+//             it inserts h := a + b on the edge,
+//   in(v)  -> out(v) if v neither kills nor computes a + b (a block that
+//             computes it saves h at its end),
+//   in(v)  -> sink if v uses a + b before any kill, with capacity freq(v):
+//             cut, the use keeps computing a + b in place.
+//
+// Only points that are reachable from the source and reach the sink take
+// part (the reduced network: a + b partially unavailable and partially
+// anticipated). Insertions never cross a kill, since a kill reconnects its
+// block to the source. Of all minimum cuts the one closest to the sink is
+// taken, which keeps the live range of h short like LCM does.
+class SpeculativePRE {
+public:
+  SpeculativePRE(const FlowGraph &g, const EvaluationSimulator &profile)
+      : _g(g), _profile(profile), _size(g.getSize()),
+        _inPlace(_size, 0), _redundant(_size, 0) {
+    build();
+    maxFlow();
+    extractCut();
+  }
+
+  // CFG edges that get h := a + b, in order of their source block.
+  const std::vector<std::pair<int, int>> &getInsertions() const {
+    return _insertions;
+  }
+
+  // Uses left computing a + b themselves (and saving h if needed later).
+  bool isComputedInPlace(int u) const { return _inPlace[u]; }
+
+  // Uses that read h.
+  bool isRedundant(int u) const { return _redundant[u]; }
+
+  // Expected evaluations of a + b per run under this placement.
+  double getEvaluations() const { return _cut + _localRecomputations; }
+
+  void getPlacement(std::ostream &outs = std::cout) const {
+    outs << "[Get Placement of Speculative PRE]:\n";
+    outs << "[Insert h := a + b on Edges]: ";
+    for (auto [u, v] : _insertions) {
+      outs << u << "->" << v << ", ";
+    }
+    outs << "\n[Computation in Place]: ";
+    for (int u = 1; u < _size - 1; ++u) {
+      if (_inPlace[u]) {
+        _g.printNode(u, outs);
+      }
+    }
+    outs << "\n[Redundant Occurrence]: ";
+    for (int u = 1; u < _size - 1; ++u) {
+      if (_redundant[u]) {
+        _g.printNode(u, outs);
+      }
+    }
+    outs << "\n";
+  }
+
+  // Predicted evaluations per run against the original program and the
+  // LCM placement of the solved graph, on the same profile.
+  void report(std::ostream &outs = std::cout) const {
+    EvaluationSimulator::Counts counts = _profile.expected();
+    outs << "[Predicted Evaluations]: original " << counts.original
+         << ", LCM " << counts.lcm << ", speculative PRE " << getEvaluations()
+         << "\n";
+    outs << "[Saving over LCM]: " << counts.lcm - getEvaluations()
+         << " evaluations per run\n";
+  }
+
+private:
+  static constexpr double kInfinity = std::numeric_limits<double>::infinity();
+  static constexpr double kEpsilon = 1e-12;
+
+  const FlowGraph &_g;
+  const EvaluationSimulator &_profile;
+  int _size;
+  std::vector<char> _inPlace;
+  std::vector<char> _redundant;
+  std::vector<std::pair<int, int>> _insertions;
+  double _cut = 0;
+  double _localRecomputations = 0;
+
+  // Network: in(v) is 2v, out(v) is 2v + 1, then source and sink. Arcs are
+  // stored in pairs (arc ^ 1 is the reverse) as linked lists in one pool.
+  int _source = 0;
+  int _sink = 0;
+  std::vector<int> _head;
+  std::vector<int> _next;
+  std::vector<int> _target;
+  std::vector<double> _capacity;
+  std::vector<int> _level;
+  std::vector<int> _current;
+
+  int in(int v) const { return 2 * v; }
+
+  int out(int v) const { return 2 * v + 1; }
+
+  bool transparent(int v) const {
+    return !_g.isKilled(v) && !_g.isComputed(v);
+  }
+
+  bool missing(int v) const {
+    return v == 0 || (_g.isKilled(v) && !_g.isComputed(v));
+  }
+
+  void addArc(int u, int v, double capacity) {
+    link(u, v, capacity);
+    link(v, u, 0);
+  }
+
+  void link(int u, int v, double capacity) {
+    _next.push_back(_head[u]);
+    _target.push_back(v);
+    _capacity.push_back(capacity);
+    _head[u] = static_cast<int>(_target.size()) - 1;
+  }
+
+  void build() {
+    std::vector<double> freq = _profile.getFrequencies();
+    for (int v = 1; v < _size - 1; ++v) {
+      _localRecomputations +=
+          freq[v] * EvaluationSimulator::getLocalRecomputations(_g, v);
+    }
+
+    // Forward from the missing points, backward from the uses.
+    std::vector<char> reach(2 * _size, 0), anticipated(2 * _size, 0);
+    std::vector<int> stack;
+    for (int v = 0; v < _size; ++v) {
+      if (missing(v)) {
+        reach[out(v)] = 1;
+        stack.push_back(out(v));
+      }
+    }
+    while (!stack.empty()) {
+      int p = stack.back();
+      stack.pop_back();
+      int v = p / 2;
+      if (p == in(v)) {
+        if (transparent(v) && !reach[out(v)]) {
+          reach[out(v)] = 1;
+          stack.push_back(out(v));
+        }
+        continue;
+      }
+      for (int w : _g.getSuccessors(v)) {
+        if (!reach[in(w)]) {
+          reach[in(w)] = 1;
+          stack.push_back(in(w));
+        }
+      }
+    }
+    for (int v = 0; v < _size; ++v) {
+      if (_g.isUsed(v)) {
+        anticipated[in(v)] = 1;
+        stack.push_back(in(v));
+      }
+    }
+    while (!stack.empty()) {
+      int p = stack.back();
+      stack.pop_back();
+      int v = p / 2;
+      if (p == out(v)) {
+        if (transparent(v) && !anticipated[in(v)]) {
+          anticipated[in(v)] = 1;
+          stack.push_back(in(v));
+        }
+        continue;
+      }
+      for (int u : _g.getPrecessors(v)) {
+        if (!anticipated[out(u)]) {
+          anticipated[out(u)] = 1;
+          stack.push_back(out(u));
+        }
+      }
+    }
+
+    _source = 2 * _size;
+    _sink = _source + 1;
+    _head.assign(_sink + 1, -1);
+    auto kept = [&](int p) { return reach[p] && anticipated[p]; };
+    for (int v = 0; v < _size; ++v) {
+      if (kept(out(v)) && missing(v)) {
+        addArc(_source, out(v), kInfinity);
+      }
+      if (kept(in(v)) && _g.isUsed(v)) {
+        addArc(in(v), _sink, freq[v]);
+      }
+      if (kept(in(v)) && kept(out(v)) && transparent(v)) {
+        addArc(in(v), out(v), kInfinity);
+      }
+      auto succs = _g.getSuccessors(v);
+      for (std::size_t k = 0; k < succs.size(); ++k) {
+        if (kept(out(v)) && kept(in(succs[k]))) {
+          addArc(out(v), in(succs[k]),
+                 _profile.getEdgeFrequency(freq, v, k));
+        }
+      }
+    }
+  }
+
+  // Dinic's algorithm: blocking flows along BFS level graphs.
+  void maxFlow() {
+    while (levels()) {
+      _current = _head;
+      blockingFlow();
+    }
+  }
+
+  bool levels() {
+    _level.assign(_head.size(), -1);
+    std::vector<int> queue = {_source};
+    _level[_source] = 0;
+    for (std::size_t k = 0; k < queue.size(); ++k) {
+      int p = queue[k];
+      for (int a = _head[p]; a >= 0; a = _next[a]) {
+        if (_capacity[a] > kEpsilon && _level[_target[a]] < 0) {
+          _level[_target[a]] = _level[p] + 1;
+          queue.push_back(_target[a]);
+        }
+      }
+    }
+    return _level[_sink] >= 0;
+  }
+
+  // Depth-first search for augmenting paths with an explicit path stack,
+  // so deep CFGs do not overflow the call stack. _current[p] is the next
+  // arc of p worth trying; dead ends leave the level graph.
+  void blockingFlow() {
+    std::vector<int> path;
+    int p = _source;
+    while (true) {
+      if (p == _sink) {
+        double pushed = kInfinity;
+        for (int a : path) {
+          pushed = std::min(pushed, _capacity[a]);
+        }
+        for (int a : path) {
+          _capacity[a] -= pushed;
+          _capacity[a ^ 1] += pushed;
+        }
+        path.clear();
+        p = _source;
+        continue;
+      }
+      int &a = _current[p];
+      while (a >= 0 && (_capacity[a] <= kEpsilon ||
+                        _level[_target[a]] != _level[p] + 1)) {
+        a = _next[a];
+      }
+      if (a >= 0) {
+        path.push_back(a);
+        p = _target[a];
+      } else if (p == _source) {
+        return;
+      } else {
+        _level[p] = -1;
+        p = _target[path.back() ^ 1];
+        path.pop_back();
+      }
+    }
+  }
+
+  // The sink side of the latest minimum cut is everything that still
+  // reaches the sink in the residual network.
+  void extractCut() {
+    std::vector<char> sinkSide(_head.size(), 0);
+    std::vector<int> stack = {_sink};
+    sinkSide[_sink] = 1;
+    while (!stack.empty()) {
+      int p = stack.back();
+      stack.pop_back();
+      for (int a = _head[p]; a >= 0; a = _next[a]) {
+        // Arc a ^ 1 runs from _target[a] to p.
+        int q = _target[a];
+        if (!sinkSide[q] && _capacity[a ^ 1] > kEpsilon) {
+          sinkSide[q] = 1;
+          stack.push_back(q);
+        }
+      }
+    }
+
+    for (int p = 0; p < _source; ++p) {
+      for (int a = _head[p]; a >= 0; a = _next[a]) {
+        if (a % 2 != 0 || sinkSide[p] || !sinkSide[_target[a]]) {
+          continue;
+        }
+        // Forward arcs are the even ones; capacity plus returned flow is
+        // the original capacity.
+        double capacity = _capacity[a] + _capacity[a ^ 1];
+        _cut += capacity;
+        if (_target[a] == _sink) {
+          _inPlace[p / 2] = 1;
+        } else {
+          _insertions.emplace_back(p / 2, _target[a] / 2);
+        }
+      }
+    }
+    std::sort(_insertions.begin(), _insertions.end());
+    for (int v = 1; v < _size - 1; ++v) {
+      _redundant[v] = _g.isUsed(v) && !_inPlace[v];
+    }
+  }
+};
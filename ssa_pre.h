@@ -0,0 +1,524 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "dominators.h"
+#include "flow_graph.h"
+
+// Sparse PRE of a + b in the style of SSAPRE (Kennedy, Chow et al.). The
+// dense analyses solve their equations at every node, although most nodes
+// neither use nor kill a + b. This engine works on the factored redundancy
+// graph of the expression instead:
+//
+//   real occurrences  the use at the entry of every used node,
+//   local values      a + b recomputed after a kill in the same block,
+//   kills             which end the current version of a + b,
+//   Φs                at the iterated dominance frontier of the used and
+//                     killed nodes, one operand per reachable predecessor.
+//
+// rename() walks these in dominator tree preorder with a stack of versions,
+// so every occurrence and Φ operand learns the value it sees. Down-safety,
+// can-be-available, later and finalization then run over the Φs and their
+// operands only. Apart from one scan of the node flags, the cost is
+// proportional to the occurrences, the Φs and the predecessors of Φ nodes;
+// the DominatorTree is built once per CFG.
+//
+// Insertions go on the edges into Φ nodes. The entry block is no placement
+// point, as for the dense analyses, so a Φ that would need an insertion on
+// an out-edge of the entry is never available. Nodes the entry does not
+// reach are ignored. On a t-refined graph (FlowGraph::makeTRefined) the
+// placement is the LCM one: an insertion on edge p -> j is the optimal
+// computation point p, a computation kept in h is an optimal computation
+// point at its own node, one that is not kept is an isolated computation.
+// crossCheck() compares the two.
+class SSAPRE {
+public:
+  // g must be finalized and have its local predicates computed, as after
+  // any of the dense analyses; dom must be the tree of g.
+  SSAPRE(const FlowGraph &g, const DominatorTree &dom)
+      : _g(g), _dom(dom), _slot(g.getSize(), -1) {}
+
+  void compute() {
+    clear();
+    placePhis();
+    rename();
+    downSafety();
+    willBeAvail();
+    finalize();
+  }
+
+  // Occurrences, Φs and Φ operands visited by the last compute().
+  long getVisitCount() const { return _visits; }
+
+  int getPhiCount() const { return _numPhis; }
+
+  // CFG edges that get h := a + b, in order of their source block.
+  const std::vector<std::pair<int, int>> &getInsertions() const {
+    return _insertions;
+  }
+
+  // Used nodes that compute a + b into h for later uses.
+  const std::vector<int> &getSaved() const { return _saved; }
+
+  // Used nodes that compute a + b and keep it nowhere.
+  const std::vector<int> &getIsolated() const { return _isolated; }
+
+  // Used nodes that read h.
+  const std::vector<int> &getRedundant() const { return _redundant; }
+
+  void getPlacement(std::ostream &outs = std::cout) const {
+    auto print = [&](const char *title, const std::vector<int> &nodes) {
+      outs << title;
+      for (int u : nodes) {
+        _g.printNode(u, outs);
+      }
+      outs << "\n";
+    };
+    outs << "[Get Placement of SSAPRE]:\n";
+    print("[Phi Nodes]: ", _phiNodes);
+    outs << "[Insert h := a + b on Edges]: ";
+    for (auto [u, v] : _insertions) {
+      outs << u << "->" << v << ", ";
+    }
+    outs << "\n";
+    print("[Compute into h := a + b]: ", _saved);
+    print("[Isolated Computation]: ", _isolated);
+    print("[Redundant Occurrence]: ", _redundant);
+  }
+
+  // Nodes where the placement differs from the LCM result of the solved
+  // graph, which should be t-refined: a different optimal computation
+  // point or isolated computation.
+  int crossCheck() const {
+    int size = _g.getSize();
+    std::vector<char> ocp(size, 0), ic(size, 0);
+    for (auto [u, v] : _insertions) {
+      ocp[u] = 1;
+    }
+    for (int u : _saved) {
+      ocp[u] = 1;
+    }
+    for (int u : _isolated) {
+      ic[u] = 1;
+    }
+    PredicateView latest = _g.getLatest(), isolated = _g.getIsolated();
+    int mismatches = 0;
+    for (int u = 1; u < size - 1; ++u) {
+      if (!_dom.isReachable(u)) {
+        continue;
+      }
+      mismatches += ocp[u] != (latest[u] && !isolated[u]) ||
+                    ic[u] != (latest[u] && isolated[u]);
+    }
+    return mismatches;
+  }
+
+private:
+  static constexpr int kBottom = -1;
+
+  enum class Kind : char { Phi, Real, Local };
+
+  // Φs take the first ids, in the order placePhis() creates them.
+  struct Occurrence {
+    Kind kind;
+    int node;
+    // The occurrence whose value this one sees (itself for a new value).
+    int version;
+    // Real: the occurrence whose h a reload reads.
+    int source = kBottom;
+    bool reload = false;
+    // Real, Local: the value stays in h for later uses.
+    bool save = false;
+    // Φ only.
+    bool downSafe = true;
+    bool canBeAvail = true;
+    bool later = true;
+    bool needed = false;
+    int firstOperand = 0;
+    int numOperands = 0;
+  };
+
+  struct Operand {
+    int phi;
+    int pred;
+    // The occurrence on top of the stack at the end of pred, or kBottom.
+    int def = kBottom;
+    // A real occurrence or local value lies between the version and pred.
+    bool realUse = false;
+    // Finalization: insert on pred -> Φ, or read h from source.
+    bool insert = false;
+    int source = kBottom;
+  };
+
+  // A node the sweeps stop at.
+  struct Site {
+    int node;
+    int phi = kBottom;
+    int real = kBottom;
+    int local = kBottom;
+  };
+
+  const FlowGraph &_g;
+  const DominatorTree &_dom;
+  // Index into _sites of every node that has one, -1 elsewhere; reset
+  // entry by entry, so a compute() never touches the other nodes.
+  std::vector<int> _slot;
+  std::vector<Site> _sites;
+  std::vector<Occurrence> _occs;
+  std::vector<Operand> _operands;
+  // Operand ids in dominator tree preorder of their predecessor.
+  std::vector<int> _byPred;
+  // Operands whose def is the Φ, as CSR over the Φ ids.
+  std::vector<int> _userOffsets;
+  std::vector<int> _users;
+  int _numPhis = 0;
+  long _visits = 0;
+  std::vector<int> _phiNodes;
+  std::vector<std::pair<int, int>> _insertions;
+  std::vector<int> _saved;
+  std::vector<int> _isolated;
+  std::vector<int> _redundant;
+
+  void clear() {
+    for (const Site &site : _sites) {
+      _slot[site.node] = -1;
+    }
+    _sites.clear();
+    _occs.clear();
+    _operands.clear();
+    _byPred.clear();
+    _numPhis = 0;
+    _visits = 0;
+    _phiNodes.clear();
+    _insertions.clear();
+    _saved.clear();
+    _isolated.clear();
+    _redundant.clear();
+  }
+
+  Site &site(int u) {
+    if (_slot[u] < 0) {
+      _slot[u] = static_cast<int>(_sites.size());
+      _sites.push_back(Site{u});
+    }
+    return _sites[_slot[u]];
+  }
+
+  bool isPhi(int occ) const { return occ >= 0 && occ < _numPhis; }
+
+  bool willBeAvail(int phi) const {
+    return _occs[phi].canBeAvail && !_occs[phi].later;
+  }
+
+  // Φs at the iterated dominance frontier of the used and killed nodes,
+  // by a worklist over the frontiers; a site marks a node as seen.
+  void placePhis() {
+    int size = _g.getSize();
+    std::vector<int> work;
+    for (int u = 1; u < size - 1; ++u) {
+      if ((_g.isUsed(u) || _g.isKilled(u)) && _dom.isReachable(u)) {
+        site(u);
+        work.push_back(u);
+      }
+    }
+    if (_dom.isReachable(size - 1)) {
+      site(size - 1);
+    }
+    while (!work.empty()) {
+      int u = work.back();
+      work.pop_back();
+      for (int j : _dom.getFrontier(u)) {
+        ++_visits;
+        bool seen = _slot[j] >= 0;
+        Site &s = site(j);
+        if (s.phi != kBottom) {
+          continue;
+        }
+        s.phi = _numPhis++;
+        _occs.push_back(Occurrence{Kind::Phi, j, s.phi});
+        _phiNodes.push_back(j);
+        if (!seen) {
+          work.push_back(j);
+        }
+      }
+    }
+    std::sort(_phiNodes.begin(), _phiNodes.end());
+
+    for (int f = 0; f < _numPhis; ++f) {
+      Occurrence &phi = _occs[f];
+      phi.firstOperand = static_cast<int>(_operands.size());
+      for (int p : _g.getPrecessors(phi.node)) {
+        if (_dom.isReachable(p)) {
+          site(p);
+          _operands.push_back(Operand{f, p});
+        }
+      }
+      phi.numOperands = static_cast<int>(_operands.size()) - phi.firstOperand;
+    }
+
+    std::sort(_sites.begin(), _sites.end(), [&](const Site &a, const Site &b) {
+      return _dom.getPreorder(a.node) < _dom.getPreorder(b.node);
+    });
+    for (int k = 0; k < static_cast<int>(_sites.size()); ++k) {
+      _slot[_sites[k].node] = k;
+    }
+    _byPred.resize(_operands.size());
+    for (int k = 0; k < static_cast<int>(_operands.size()); ++k) {
+      _byPred[k] = k;
+    }
+    std::sort(_byPred.begin(), _byPred.end(), [&](int a, int b) {
+      return _slot[_operands[a].pred] < _slot[_operands[b].pred];
+    });
+  }
+
+  int addOccurrence(Kind kind, int node, int version) {
+    int id = static_cast<int>(_occs.size());
+    _occs.push_back(Occurrence{kind, node, version == kBottom ? id : version});
+    return id;
+  }
+
+  // A Φ whose version meets a kill or the exit before any use is not
+  // down-safe.
+  void endVersion(int top) {
+    if (isPhi(top)) {
+      _occs[top].downSafe = false;
+    }
+  }
+
+  void rename() {
+    int exit = _g.getSize() - 1;
+    // (node, occurrence) pairs; kBottom after a kill.
+    std::vector<std::pair<int, int>> stack;
+    auto top = [&] { return stack.empty() ? kBottom : stack.back().second; };
+    std::size_t next = 0;
+    for (Site &s : _sites) {
+      int u = s.node;
+      ++_visits;
+      while (!stack.empty() && !_dom.dominates(stack.back().first, u)) {
+        stack.pop_back();
+      }
+      if (s.phi != kBottom) {
+        stack.emplace_back(u, s.phi);
+      }
+      if (u == exit) {
+        endVersion(top());
+      } else if (u != 0) {
+        if (_g.isUsed(u)) {
+          int x = top();
+          s.real = addOccurrence(Kind::Real, u,
+                                 x == kBottom ? kBottom : _occs[x].version);
+          stack.emplace_back(u, s.real);
+        }
+        if (_g.isKilled(u)) {
+          endVersion(top());
+          stack.emplace_back(u, kBottom);
+          if (_g.isComputed(u)) {
+            s.local = addOccurrence(Kind::Local, u, kBottom);
+            stack.emplace_back(u, s.local);
+          }
+        }
+      }
+      for (; next < _byPred.size() && _operands[_byPred[next]].pred == u;
+           ++next) {
+        Operand &op = _operands[_byPred[next]];
+        ++_visits;
+        op.def = top();
+        op.realUse = op.def != kBottom && !isPhi(op.def);
+      }
+    }
+  }
+
+  // A Φ that is not down-safe makes every Φ that reaches one of its
+  // operands without a real use in between not down-safe either.
+  void downSafety() {
+    std::vector<int> work;
+    for (int f = 0; f < _numPhis; ++f) {
+      if (!_occs[f].downSafe) {
+        work.push_back(f);
+      }
+    }
+    while (!work.empty()) {
+      const Occurrence &phi = _occs[work.back()];
+      work.pop_back();
+      for (int k = 0; k < phi.numOperands; ++k) {
+        const Operand &op = _operands[phi.firstOperand + k];
+        ++_visits;
+        if (isPhi(op.def) && !op.realUse && _occs[op.def].downSafe) {
+          _occs[op.def].downSafe = false;
+          work.push_back(op.def);
+        }
+      }
+    }
+  }
+
+  void willBeAvail() {
+    _userOffsets.assign(_numPhis + 1, 0);
+    for (const Operand &op : _operands) {
+      if (isPhi(op.def) && !op.realUse) {
+        ++_userOffsets[op.def + 1];
+      }
+    }
+    for (int f = 0; f < _numPhis; ++f) {
+      _userOffsets[f + 1] += _userOffsets[f];
+    }
+    _users.resize(_userOffsets[_numPhis]);
+    std::vector<int> fill(_userOffsets.begin(), _userOffsets.end() - 1);
+    for (int k = 0; k < static_cast<int>(_operands.size()); ++k) {
+      const Operand &op = _operands[k];
+      if (isPhi(op.def) && !op.realUse) {
+        _users[fill[op.def]++] = k;
+      }
+    }
+
+    // Can-be-available: a Φ with a bottom operand cannot be made available
+    // unless it is down-safe and the insertion is not on an entry edge. A
+    // Φ that cannot turns the operands it defines into bottom ones.
+    std::vector<int> work;
+    for (int f = 0; f < _numPhis; ++f) {
+      Occurrence &phi = _occs[f];
+      for (int k = 0; k < phi.numOperands && phi.canBeAvail; ++k) {
+        const Operand &op = _operands[phi.firstOperand + k];
+        if (op.def == kBottom && (!phi.downSafe || op.pred == 0)) {
+          phi.canBeAvail = false;
+          work.push_back(f);
+        }
+      }
+    }
+    while (!work.empty()) {
+      int g = work.back();
+      work.pop_back();
+      for (int k = _userOffsets[g]; k < _userOffsets[g + 1]; ++k) {
+        Occurrence &phi = _occs[_operands[_users[k]].phi];
+        ++_visits;
+        if (phi.canBeAvail && !phi.downSafe) {
+          phi.canBeAvail = false;
+          work.push_back(_operands[_users[k]].phi);
+        }
+      }
+    }
+
+    // Later: a Φ can be postponed unless a real use reaches one of its
+    // operands, or it feeds a Φ that cannot be postponed.
+    for (int f = 0; f < _numPhis; ++f) {
+      Occurrence &phi = _occs[f];
+      phi.later = phi.canBeAvail;
+      for (int k = 0; k < phi.numOperands && phi.later; ++k) {
+        if (_operands[phi.firstOperand + k].realUse) {
+          phi.later = false;
+          work.push_back(f);
+        }
+      }
+    }
+    while (!work.empty()) {
+      int g = work.back();
+      work.pop_back();
+      for (int k = _userOffsets[g]; k < _userOffsets[g + 1]; ++k) {
+        Occurrence &phi = _occs[_operands[_users[k]].phi];
+        ++_visits;
+        if (phi.later) {
+          phi.later = false;
+          work.push_back(_operands[_users[k]].phi);
+        }
+      }
+    }
+  }
+
+  // Second preorder sweep: availDef[x] is the occurrence that holds
+  // version x in h at the current node, if it dominates the node. Reals
+  // reload from it, the operands of available Φs read it or get an
+  // insertion. Then keep in h exactly what a reload needs, through the Φs.
+  void finalize() {
+    std::vector<int> availDef(_occs.size(), kBottom);
+    auto available = [&](int x, int u) {
+      int d = availDef[x];
+      return d != kBottom && _dom.dominates(_occs[d].node, u) ? d : kBottom;
+    };
+    std::size_t next = 0;
+    for (const Site &s : _sites) {
+      int u = s.node;
+      if (s.phi != kBottom) {
+        availDef[s.phi] = willBeAvail(s.phi) ? s.phi : kBottom;
+      }
+      if (s.real != kBottom) {
+        Occurrence &real = _occs[s.real];
+        int d = real.version == s.real ? kBottom : available(real.version, u);
+        if (d != kBottom) {
+          real.reload = true;
+          real.source = d;
+        } else {
+          availDef[real.version] = s.real;
+        }
+      }
+      if (s.local != kBottom) {
+        availDef[s.local] = s.local;
+      }
+      for (; next < _byPred.size() && _operands[_byPred[next]].pred == u;
+           ++next) {
+        Operand &op = _operands[_byPred[next]];
+        if (!willBeAvail(op.phi)) {
+          continue;
+        }
+        if (op.def != kBottom) {
+          op.source = available(_occs[op.def].version, u);
+        }
+        op.insert = op.source == kBottom;
+      }
+    }
+
+    std::vector<int> work;
+    auto keep = [&](int d) {
+      if (!isPhi(d)) {
+        _occs[d].save = true;
+      } else if (!_occs[d].needed) {
+        _occs[d].needed = true;
+        work.push_back(d);
+      }
+    };
+    for (const Occurrence &occ : _occs) {
+      if (occ.reload) {
+        keep(occ.source);
+      }
+    }
+    while (!work.empty()) {
+      const Occurrence &phi = _occs[work.back()];
+      work.pop_back();
+      for (int k = 0; k < phi.numOperands; ++k) {
+        const Operand &op = _operands[phi.firstOperand + k];
+        if (op.insert) {
+          _insertions.emplace_back(op.pred, phi.node);
+        } else {
+          keep(op.source);
+        }
+      }
+    }
+    std::sort(_insertions.begin(), _insertions.end());
+
+    // A block that uses a + b, kills it and computes it again hands on h
+    // from the last computation; as in the dense placement (see
+    // FlowGraph::getPlacementInstrLCM), the block counts as computing
+    // into h.
+    for (const Site &s : _sites) {
+      if (s.real != kBottom && s.local != kBottom && _occs[s.local].save) {
+        _occs[s.real].save = true;
+      }
+    }
+    for (const Occurrence &occ : _occs) {
+      if (occ.kind != Kind::Real) {
+        continue;
+      }
+      if (occ.reload) {
+        _redundant.push_back(occ.node);
+      } else if (occ.save) {
+        _saved.push_back(occ.node);
+      } else {
+        _isolated.push_back(occ.node);
+      }
+    }
+    std::sort(_saved.begin(), _saved.end());
+    std::sort(_isolated.begin(), _isolated.end());
+    std::sort(_redundant.begin(), _redundant.end());
+  }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Trace output of the fixpoint solvers. Tracing is chosen at compile time by
+// the Trace parameter of each analysis (Tracer<false> compiles to nothing)
+// and at run time by a TraceLevel and a pluggable TraceSink.
+enum class TraceLevel { None = 0, Update = 1, Debug = 2 };
+
+class TraceSink {
+public:
+  virtual ~TraceSink() {}
+
+  // Receives one complete, newline-terminated line per call.
+  virtual void write(std::string_view line) = 0;
+
+  virtual void flush() {}
+};
+
+class NullTraceSink : public TraceSink {
+public:
+  void write(std::string_view) override {}
+};
+
+// Collects lines in a buffer and hands them to the stream in large blocks.
+class StreamTraceSink : public TraceSink {
+public:
+  StreamTraceSink(std::ostream &outs, std::size_t capacity = 1 << 16)
+      : _outs(outs), _capacity(capacity) {
+    _buffer.reserve(capacity);
+  }
+
+  ~StreamTraceSink() override { flush(); }
+
+  void write(std::string_view line) override {
+    if (_buffer.size() + line.size() > _capacity) {
+      flush();
+    }
+    _buffer.append(line);
+  }
+
+  void flush() override {
+    _outs.write(_buffer.data(), _buffer.size());
+    _outs.flush();
+    _buffer.clear();
+  }
+
+private:
+  std::ostream &_outs;
+  std::size_t _capacity;
+  std::string _buffer;
+};
+
+class FileTraceSink : public TraceSink {
+public:
+  FileTraceSink(const std::string &Filepath)
+      : _file(Filepath, std::ios::out | std::ios::trunc), _stream(_file) {}
+
+  void write(std::string_view line) override { _stream.write(line); }
+
+  void flush() override { _stream.flush(); }
+
+private:
+  std::ofstream _file;
+  StreamTraceSink _stream;
+};
+
+// Keeps only the most recent lines, for post-mortem inspection.
+class RingTraceSink : public TraceSink {
+public:
+  RingTraceSink(std::size_t capacity) : _lines(capacity) {}
+
+  void write(std::string_view line) override {
+    _lines[_next % _lines.size()].assign(line);
+    ++_next;
+  }
+
+  std::vector<std::string> getLines() const {
+    std::vector<std::string> res;
+    std::size_t first = _next > _lines.size() ? _next - _lines.size() : 0;
+    for (std::size_t i = first; i < _next; ++i) {
+      res.push_back(_lines[i % _lines.size()]);
+    }
+    return res;
+  }
+
+private:
+  std::vector<std::string> _lines;
+  std::size_t _next = 0;
+};
+
+inline TraceSink &coutTraceSink() {
+  static StreamTraceSink sink(std::cout);
+  return sink;
+}
+
+template <bool Enabled> class Tracer;
+
+template <> class Tracer<false> {
+public:
+  void update(const char *, int, int) {}
+
+  void push(int) {}
+
+  void flush() {}
+};
+
+template <> class Tracer<true> {
+public:
+  Tracer(TraceSink &sink = coutTraceSink(),
+         TraceLevel level = TraceLevel::Update)
+      : _sink(&sink), _level(level) {}
+
+  // "[Update] <name>[<node>] := True|False"
+  void update(const char *name, int node, int value) {
+    if (_level < TraceLevel::Update) {
+      return;
+    }
+    char buf[96];
+    char *p = append(buf, "[Update] ");
+    p = append(p, name);
+    p = append(p, "[");
+    p = std::to_chars(p, buf + sizeof(buf), node).ptr;
+    p = append(p, value ? "] := True\n" : "] := False\n");
+    _sink->write({buf, static_cast<std::size_t>(p - buf)});
+  }
+
+  // "[Debug] Add to worklist: <node>"
+  void push(int node) {
+    if (_level < TraceLevel::Debug) {
+      return;
+    }
+    char buf[48];
+    char *p = append(buf, "[Debug] Add to worklist: ");
+    p = std::to_chars(p, buf + sizeof(buf), node).ptr;
+    *p++ = '\n';
+    _sink->write({buf, static_cast<std::size_t>(p - buf)});
+  }
+
+  void flush() { _sink->flush(); }
+
+private:
+  TraceSink *_sink;
+  TraceLevel _level;
+
+  // Callers keep the names short enough for the line buffers above.
+  static char *append(char *p, const char *str) {
+    std::size_t len = std::strlen(str);
+    std::memcpy(p, str, len);
+    return p + len;
+  }
+};
+
+using NoTrace = Tracer<false>;